@@ -44,6 +44,8 @@
 #include <algorithm>
 #include <iterator>
 #include <thread>
+#include <mutex>
+#include <atomic>
 //#include <pthread.h>
 #include <map>
 #include <array>
@@ -232,6 +234,18 @@ constexpr U64 pawn_attacks_bb(U64 b) {
         : shift<SOUTH_WEST>(b) | shift<SOUTH_EAST>(b);
 }
 
+inline U64 north_fill(U64 b) { b |= b << 8; b |= b << 16; return b | (b << 32); }
+inline U64 south_fill(U64 b) { b |= b >> 8; b |= b >> 16; return b | (b >> 32); }
+inline U64 file_fill(U64 b) { return north_fill(south_fill(b)); }
+inline U64 adjacent_files(U64 b) { return shift<EAST>(b) | shift<WEST>(b); }
+
+//squares strictly ahead of / behind b, as seen from C's side
+template<Color C>
+inline U64 front_span(U64 b) { return C == WHITE ? north_fill(b << 8) : south_fill(b >> 8); }
+
+template<Color C>
+inline U64 rear_span(U64 b) { return C == WHITE ? south_fill(b >> 8) : north_fill(b << 8); }
+
 constexpr Direction pawn_push(Color c) {
     return c == WHITE ? NORTH : SOUTH;
 }
@@ -382,6 +396,30 @@ inline Score operator*(Score s, int i) {
     return result;
 }
 
+// Slider tables are indexed with BMI2 PEXT instead of the magic multiply when the CPU has a fast
+// PEXT. The instructions are emitted through inline assembly, so the build itself needs no -mbmi2.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define PEXT_ATTACKS
+#endif
+extern bool use_pext;
+bool cpu_has_fast_pext();
+
+#ifdef PEXT_ATTACKS
+inline U64 pext(U64 src, U64 mask)
+{
+    U64 r;
+    __asm__("pextq %2, %1, %0" : "=r"(r) : "r"(src), "rm"(mask));
+    return r;
+}
+
+inline U64 pdep(U64 src, U64 mask)
+{
+    U64 r;
+    __asm__("pdepq %2, %1, %0" : "=r"(r) : "r"(src), "rm"(mask));
+    return r;
+}
+#endif
+
 struct SMagic {
     U64 mask;
     U64 magic;
@@ -394,6 +432,14 @@ struct SMagic {
     }
 };
 
+// The PEXT tables store each attack set compressed to the bits of the empty-board attacks (at most
+// 14 for a rook), and PDEP expands it again. At 16 bits an entry they are a quarter of the magic
+// tables, so far more of them stays in L1/L2 next to the TT traffic.
+struct alignas(16) SPext {
+    U64 mask;
+    uint16_t* aptr;
+};
+
 /// http://vigna.di.unimi.it/ftp/papers/xorshift.pdf
 class PRNG {
 
@@ -448,11 +494,29 @@ extern uint8_t PopCnt16[1 << 16];
 
 extern SMagic mBishopTbl[64];
 extern SMagic mRookTbl[64];
+extern SPext mBishopPext[64];
+extern SPext mRookPext[64];
+
+// Builds without -DUSE_POPCNT still issue POPCNT when the CPU has it, so a single x86-64 binary
+// gets the hardware count on every machine that supports one.
+#if !defined(USE_POPCNT) && defined(__GNUC__) && defined(__x86_64__)
+#define POPCNT_DISPATCH
+#endif
+extern bool use_popcnt;
 
 inline int POPCOUNT(uint64_t x)
 {
 #ifndef USE_POPCNT
 
+#ifdef POPCNT_DISPATCH
+    if (use_popcnt)
+    {
+        uint64_t r;
+        __asm__("popcntq %1, %0" : "=r"(r) : "rm"(x));
+        return int(r);
+    }
+#endif
+
     union { uint64_t bb; uint16_t u[4]; } v = { x };
     return PopCnt16[v.u[0]] + PopCnt16[v.u[1]] + PopCnt16[v.u[2]] + PopCnt16[v.u[3]];
 
@@ -468,7 +532,9 @@ inline int POPCOUNT(uint64_t x)
 }
 
 void init_boards();
+void init_search_tables();
 void init_magics(U64 attackTable[], SMagic magics[], U64* masks, U64(*func)(U64, int), const U64* magicNumbers);
+void init_pext(uint16_t attackTable[], SPext tables[], U64* masks, U64(*func)(U64, int));
 void init_values();
 void init_threads();
 void reset_threads(int thread_num);
@@ -479,25 +545,44 @@ U64 bishopAttacks_slow(U64 occ, int sq);
 
 inline U64 bishopAttacks(U64 occ, int sq)
 {
+#ifdef PEXT_ATTACKS
+    if (use_pext)
+        return pdep(mBishopPext[sq].aptr[pext(occ, mBishopPext[sq].mask)], PseudoAttacks[BISHOP][sq]);
+#endif
     const SMagic m = mBishopTbl[sq];
     return m.aptr[m.index(occ)];
 }
 
 inline U64 rookAttacks(U64 occ, int sq)
 {
+#ifdef PEXT_ATTACKS
+    if (use_pext)
+        return pdep(mRookPext[sq].aptr[pext(occ, mRookPext[sq].mask)], PseudoAttacks[ROOK][sq]);
+#endif
     const SMagic m = mRookTbl[sq];
     return m.aptr[m.index(occ)];
 }
 
+// AVX2 Kogge-Stone slider attacks for the evaluation; with -DAVX2_EVAL they are used when the CPU has AVX2
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_ATTACKS
+#endif
+extern bool use_avx2_attacks;
+void init_simd_attacks();
+void slider_attacks_avx2(const int *squares, const U64 *occ, U64 *out, int n, bool diagonal, bool orthogonal);
+
 char PieceChar(PieceCode c, bool lower = false);
 
+constexpr int16_t SEE_UNKNOWN = INT16_MIN;
+
 struct SMove
 {
 public:
     Move code;
+    int16_t see; // exchange value, filled in when captures are scored; sits in what was padding
     int value;
     operator Move() const { return code; }
-    void operator=(Move m) { code = m; }
+    void operator=(Move m) { code = m; see = SEE_UNKNOWN; }
 
     bool operator<(const SMove m) const { return (value < m.value); }
     bool operator>(const SMove m) const { return (value > m.value); }
@@ -512,6 +597,7 @@ typedef struct Position Position;
 typedef struct SearchThread SearchThread;
 typedef struct pawnhashTable pawnhashTable;
 typedef struct searchInfo searchInfo;
+typedef struct materialEntry materialEntry;
 typedef struct materialhashEntry materialhashEntry;
 
 struct stateHistory
@@ -521,6 +607,8 @@ struct stateHistory
     U64 materialhash;
     U64 blockersForKing[2][2]; //color x (diag/straight)
     U64 checkBB;
+    U64 checkSquares[7];
+    U64 dcCandidates;
     uint8_t castleRights;
     int epSquare;
     int kingpos[2];
@@ -529,8 +617,6 @@ struct stateHistory
     PieceCode capturedPiece;
 };
 
-// TODO (drstrange767#1#): Add checkSquares in Position to upgrade gives check method
-
 class Position
 {
 public:
@@ -540,6 +626,8 @@ public:
     U64 materialhash;
     U64 blockersForKing[2][2]; //color x (diag/straight)
     U64 checkBB;
+    U64 checkSquares[7]; //squares from which each piece type of the side to move would check the opponent king
+    U64 dcCandidates; //pieces of the side to move that give discovered check by leaving the king's line
     uint8_t castleRights; // BK BQ WK WQ
     int epSquare;
     int kingpos[2];
@@ -562,6 +650,14 @@ public:
     int nonPawn[2];
     bool gameCycle;
 
+    // Incremental attack maps, compiled in with -DATTACKMAPS (make attackmaps). Slower than
+    // recomputing with magics in this engine: see the commit that added them for numbers.
+    #ifdef ATTACKMAPS
+    U64 attacksFrom[64]; // attacks of the piece on each square under the current occupancy
+    U64 sideAttacks[2];
+    void update_attacks(U64 changed);
+    #endif // ATTACKMAPS
+
     static void init();
 
     bool isAttacked(int square, int side) const;
@@ -573,6 +669,7 @@ public:
     bool pawnOn7th() const;
     int smallestAttacker(U64 attackers, Color color) const;
     bool see(Move m, int threshold) const;
+    int see_value(Move m) const;
     U64 attackersTo(int square, int side, bool free = false) const;
     U64 attackers_to(int sq, int side, U64 occ) const;
     U64 all_attackers_to(int sq, U64 occ) const;
@@ -580,6 +677,8 @@ public:
     bool givesCheck(Move m);
     bool givesDiscoveredCheck(Move m) const;
     bool advanced_pawn_push(Move m) const;
+    U64 key_after(Move m) const;
+    void prefetch_after(Move m) const;
     void do_move(Move m);
     void undo_move(Move m);
     void do_null_move();
@@ -592,6 +691,7 @@ public:
     bool horizontalCheck(U64 occ, int sq) const;
 
     void updateBlockers();
+    void updateCheckInfo();
     void readFEN(const char* fen);
 
     int scaleFactor() const;
@@ -599,12 +699,41 @@ public:
     friend ostream& operator<<(ostream& os, const Position& p);
 };
 
+#ifdef ATTACKMAPS
+#define ATTACKS_FROM(pos, sq, occ) ((pos).attacksFrom[sq])
+#else
+#define ATTACKS_FROM(pos, sq, occ) ((pos).getAttackSet(sq, occ))
+#endif // ATTACKMAPS
+
 // assuming that Move m gives check, if it was a blocker then it's a discovered check
 inline bool Position::givesDiscoveredCheck(Move m) const
 {
-    return (blockersForKing[~activeSide][0] | blockersForKing[~activeSide][1]) & BITSET(from_sq(m));
+    return dcCandidates & BITSET(from_sq(m));
 }
 
+#ifdef COPYMAKE
+// Copy-make experiment, compiled in with -DCOPYMAKE (make copymake): a board small enough to copy
+// at every ply instead of do_move/undo_move on Position. Only perft runs on it ("copyperft <depth>");
+// see the commit that added it for numbers.
+struct CompactBoard
+{
+    U64 pieces[7]; // by PieceType, pieces[BLANKTYPE] holds every occupied square
+    U64 colors[2];
+    U64 key;
+    uint8_t kingpos[2];
+    uint8_t castleRights;
+    uint8_t epSquare;
+    uint8_t halfmoveClock;
+    uint8_t activeSide;
+};
+
+void compact_board(const Position& pos, CompactBoard* b);
+Move* generate_compact(const CompactBoard& b, Move* list);
+void copy_make(const CompactBoard& b, CompactBoard* next, Move m);
+U64 perft_compact(const CompactBoard& b, int depth, bool bulk);
+void copymake_perft(Position& pos, int depth);
+#endif // COPYMAKE
+
 Position* start_position();
 Position* import_fen(const char* fen, int thread_id);
 
@@ -703,9 +832,11 @@ class MoveGen
 {
 public:
     MoveGen(Position* p, SearchType type, Move hshm, int t, int d);
+    MoveGen(const MoveGen&) = delete;
+    MoveGen& operator=(const MoveGen&) = delete;
     int state;
-    SMove moveList[256];
-    SMove* curr, * endMoves, * endBadCaptures;
+    SMove* moveList; // start of this node's moves in the thread's move buffer
+    SMove* curr, * endMoves, * endBadCaptures, * endSorted;
     Move hashmove;
     Move counterMove;
     int threshold;
@@ -714,8 +845,14 @@ public:
     Move next_move(searchInfo* info, bool skipQuiets = false);
     void scoreMoves(searchInfo* info, ScoreType type);
     template <PickType type> Move select_move();
+    bool see(Move m, int bound) const;
 private:
     Position* pos;
+    SMove* picked; // list entry of the last move handed out, to reuse its stored SEE
+    // Opponent attacks, computed when quiets get scored; each set includes the cheaper attackers' squares
+    U64 threatByPawn, threatByMinor, threatByRook;
+    void compute_threats();
+    template <MoveType Mt> void generate(); // fills the list from curr and claims it in the move buffer
     SMove* begin() { return curr; };
     SMove* end() { return endMoves; };
 };
@@ -725,16 +862,34 @@ vector<string> SplitString(const char* c);
 void printBits(U64 x);
 
 #define TRANSPOSITION_MB 64 // default size
-constexpr int PAWN_ENTRIES = 16384; // default size
-constexpr int PAWN_HASH_SIZE_MASK = PAWN_ENTRIES - 1;
 
-constexpr int MATERIAL_ENTRIES = 65536; // default size
-constexpr int MATERIAL_HASH_SIZE_MASK = MATERIAL_ENTRIES - 1;
+// Largest piece counts covered by the shared material table, by PieceCode
+constexpr int materialMax[14] = { 0, 0, 8, 8, 2, 2, 2, 2, 2, 2, 1, 1, 0, 0 };
+constexpr int MATERIAL_ENTRIES = 9 * 9 * 3 * 3 * 3 * 3 * 3 * 3 * 2 * 2;
+
+constexpr int MATERIAL_OVERFLOW_ENTRIES = 1024; // per thread, for promoted extra pieces
+constexpr int MATERIAL_OVERFLOW_MASK = MATERIAL_OVERFLOW_ENTRIES - 1;
+
+// Slot of a material configuration in the shared material table, or -1 when a count is out of range
+inline int material_index(const int* pieceCount)
+{
+    int index = 0;
+    for (int pc = BQUEEN; pc >= WPAWN; pc--)
+    {
+        if (pieceCount[pc] > materialMax[pc])
+            return -1;
+        index = index * (materialMax[pc] + 1) + pieceCount[pc];
+    }
+    return index;
+}
 
 const uint8_t FLAG_ALPHA = 1;
 const uint8_t FLAG_BETA = 2;
 const uint8_t FLAG_EXACT = 3; // FLAG_ALPHA | FLAG_BETA
 
+// hashupper holds the upper 16 bits of the key XORed with a fold of the 64 bits that follow it,
+// which are always read and written as a single word. An entry torn by concurrent writers fails
+// the check and is treated as a miss.
 struct TTEntry
 {
     uint16_t hashupper;
@@ -745,20 +900,40 @@ struct TTEntry
     uint8_t flags;
 };
 
+static_assert(sizeof(TTEntry) == 10, "TTEntry must stay packed");
+
+// flags: bound in bits 0-1, PV node in bit 2, generation in bits 3-7
 inline uint8_t tte_flag(TTEntry* tte) {
     return (uint8_t)(tte->flags & 0x3);
 }
 
+inline bool tte_pv(TTEntry* tte) {
+    return (tte->flags >> 2) & 1;
+}
+
 inline uint8_t tte_age(TTEntry* tte) {
-    return (uint8_t)(tte->flags >> 2);
+    return (uint8_t)(tte->flags >> 3);
 }
 
+// The first two entries of a bucket are depth-preferred, the last one is always replaced
+const int TT_ALWAYS_SLOT = 2;
+
 struct TTBucket
 {
     TTEntry entries[3];
     char padding[2];
 };
 
+// Lives in the first page of a shared table so that cooperating processes age entries together
+struct sharedTTHeader
+{
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t bucketSize;
+    U64 table_size;
+    uint8_t generation;
+};
+
 struct transpositionTable
 {
     TTBucket* table;
@@ -766,17 +941,50 @@ struct transpositionTable
     uint8_t generation;
     U64 table_size;
     U64 size_mask;
+    sharedTTHeader* shared;
+    size_t shared_size;
 };
 
 extern transpositionTable TT;
+extern string sharedHashName;
+
+// Probe/store counters, compiled in with -DTTSTATS (make ttstats). They are plain
+// counters shared by all threads, so with more than one thread they are approximate.
+#ifdef TTSTATS
+const int TTSTATS_DEPTHS = 32;
+
+struct ttStatistics
+{
+    U64 probes;
+    U64 hits;
+    U64 blankMisses;
+    U64 victimMisses;
+    U64 stores;
+    U64 storeSkips;
+    U64 sameKeyStores;
+    U64 replacements;
+    U64 redirects;
+    U64 badHashMoves;
+    U64 storeDepths[TTSTATS_DEPTHS];
+};
+
+extern ttStatistics ttstats;
+#define TTSTAT(x) (ttstats.x++)
+#else
+#define TTSTAT(x)
+#endif // TTSTATS
 
 void start_search();
 void init_tt();
+void alloc_tt();
 void clear_tt();
 void reset_tt(int MB);
+bool attach_shared_tt(string name, int MB);
+void detach_shared_tt();
 int hashfull();
-void storeEntry(TTEntry* entry, U64 key, Move m, int depth, int score, int staticEval, uint8_t flag);
-TTEntry* probeTT(U64 key, bool& ttHit);
+void storeEntry(TTEntry* entry, U64 key, Move m, int depth, int score, int staticEval, uint8_t flag, bool pv);
+TTEntry* probeTT(U64 key, bool& ttHit, TTEntry& ttData);
+void print_ttstats();
 int score_to_tt(int score, uint16_t ply);
 int tt_to_score(int score, uint16_t ply);
 
@@ -792,16 +1000,27 @@ struct pawnhashEntry
     uint8_t castling;
 };
 
-struct materialhashEntry
+struct materialEntry
 {
-    U64 key;
     Score score;
-    int phase;
+    int16_t phase;
     bool isDrawn;
-    bool hasSpecialEndgame;
-    int (*evaluation)(const Position&);
+    uint8_t variant; // EvalVariant to run for this material
+    uint8_t strongSide; // side the endgame functions below are written for
+    uint8_t evaluation; // index into endgameFunctions, 0 if none
+    uint8_t scaling; // index into endgameFunctions, 0 if none
+};
+
+struct materialhashEntry
+{
+    U64 key;
+    materialEntry material;
 };
 
+// Specialized builds of Eval<T>::value(): each bit names material that is absent from the
+// board, letting the compiler drop the terms that would be zero anyway
+enum EvalVariant { EVAL_GENERIC = 0, EVAL_NO_QUEENS = 1, EVAL_NO_ROOKS = 2, EVAL_MINORS = EVAL_NO_QUEENS | EVAL_NO_ROOKS, EVAL_PAWNLESS = 4 };
+
 enum Tracing { NO_TRACE, DO_TRACE };
 
 template <Tracing T>
@@ -816,11 +1035,13 @@ private:
     void evaluate_pawns();
     template <Color side> void evaluate_pawn_structure();
     template <Color side> Score evaluate_passers();
-    template <Color side> Score king_safety() const;
+    template <Color side, int V = EVAL_GENERIC> Score king_safety() const;
     template <Color side> int pawn_shelter_score(int sq);
     template <Color side> void pawn_shelter_castling();
     template <Color side, PieceType type> Score evaluate_piece();
-    template <Color side> Score evaluate_threats() const;
+    template <Color side, int V = EVAL_GENERIC> Score evaluate_threats() const;
+    template <int V> int evaluate_variant(const materialEntry* material);
+    void slider_attacks();
     U64 mobility_area[2];
     Score mobility[2] = {S(0,0), S(0,0)};
     U64 double_targets[2];
@@ -829,6 +1050,7 @@ private:
     int king_attackers_count[2];
     int king_attacks_count[2];
     int king_attackers_weight[2];
+    U64 sliderAttacks[64]; // filled by slider_attacks() on the AVX2 path
 };
 
 enum evalTerms { MATERIAL, MOBILITY, KNIGHTS, BISHOPS, ROOKS, QUEENS, IMBALANCE, PAWNS, PASSERS, KING_SAFETY, THREAT, TOTAL, PHASE, SCALE, TEMPO, TERM_NB };
@@ -837,7 +1059,53 @@ extern Score trace_scores[TERM_NB][2];
 
 int evaluate(const Position& p);
 string trace(const Position& p);
-int KBNvK(const Position& pos);
+
+// NNUE evaluation, used instead of the hand-crafted eval once an EvalFile is loaded.
+// Input features are (king bucket, piece, square) from each side's point of view, with the
+// board mirrored so that the own king is always on files a-d. The own king only selects the
+// bucket; the enemy king is an ordinary feature.
+const int NNUE_BUCKETS = 16;
+const int NNUE_PIECES = 11;
+const int NNUE_INPUTS = NNUE_BUCKETS * NNUE_PIECES * 64;
+const int NNUE_HIDDEN = 256;
+const int NNUE_L2 = 32;
+const int NNUE_L3 = 32;
+const int NNUE_STACK = MAX_PLY + 8;
+const int MOVE_BUFFER_SIZE = 2 * (MAX_PLY + 8) * 256; // a node and its singular search can both hold a list at each ply
+
+// One per ply of the search. do_move only records which pieces moved; evaluate() brings
+// the accumulator up to date from the nearest computed ancestor, or refreshes it when the
+// king bucket changed on the way.
+struct NNUEAccumulator
+{
+    int16_t values[2][NNUE_HIDDEN];
+    bool computed[2];
+    bool refresh[2];
+    uint8_t dirtyCount;
+    PieceCode dirtyPiece[3];
+    uint8_t dirtyFrom[3]; // 64 when the piece appears
+    uint8_t dirtyTo[3];   // 64 when the piece disappears
+};
+
+extern bool use_nnue;
+extern string evalFilePath;
+
+bool nnue_load(string path);
+void nnue_unload();
+int nnue_evaluate(const Position& pos);
+NNUEAccumulator* nnue_push(const Position& pos);
+void nnue_dirty(NNUEAccumulator* acc, PieceCode pc, int from, int to);
+void init_nnue();
+
+typedef int (*EndgameFunction)(const Position&, Color);
+extern const EndgameFunction endgameFunctions[];
+
+void init_endgames();
+void probe_endgame(const int* pieceCount, materialEntry* material);
+U64 materialKey(const int* pieceCount);
+
+void init_material();
+materialEntry* probeMaterial(const Position& pos);
 
 struct PSQT {
     Score psqt[14][64];
@@ -874,15 +1142,23 @@ struct SearchThread
     U64 nodes;
     U64 tb_hits;
     int rootheight; ///this is how many ply from 0 the current root is
-    pawnhashEntry pawntable[PAWN_ENTRIES];
-    materialhashEntry materialTable[MATERIAL_ENTRIES];
+    pawnhashEntry* pawntable; ///kept across searches, cleared on ucinewgame
+    U64 pawntableMask;
+    materialhashEntry materialOverflow[MATERIAL_OVERFLOW_ENTRIES];
     bool doNMP;
     jmp_buf jbuffer;
+    NNUEAccumulator nnueStack[NNUE_STACK];
+    U64* evalCache; ///upper 48 bits of the key | 16 bit eval
+    U64 evalCacheMask;
+    U64 evalCacheProbes;
+    U64 evalCacheHits;
+    SMove moveBuffer[MOVE_BUFFER_SIZE]; ///move lists of the nodes on the current search path, packed back to back
+    SMove* moveTop; ///first free entry; each MoveGen claims what it generates, the search hands it back when the node returns
 };
 
 inline pawnhashEntry* get_pawntte(const Position& pos)
 {
-    return &pos.my_thread->pawntable[pos.pawnhash & (PAWN_HASH_SIZE_MASK)];
+    return &pos.my_thread->pawntable[pos.pawnhash & pos.my_thread->pawntableMask];
 }
 
 inline bool is_main_thread(Position* p) { return p->my_thread->thread_id == 0; }
@@ -894,6 +1170,15 @@ extern SearchThread* search_threads;
 inline void* get_thread(int thread_id) { return thread_id == 0 ? &main_thread : &search_threads[thread_id - 1]; }
 void clear_threads();
 
+#define EVALCACHE_MB 1 // default size per thread
+extern int evalCacheMB;
+void resize_eval_caches(int mbSize);
+void clear_eval_caches();
+
+#define PAWNHASH_MB 2 // default size per thread
+extern int pawnHashMB;
+void resize_pawn_tables(int mbSize);
+
 extern const int PAWN_MG;
 extern const int PAWN_EG;
 extern const int KNIGHT_MG;
@@ -919,6 +1204,7 @@ constexpr int SCALE_NOPAWNS = 0;
 constexpr int SCALE_HARDTOWIN = 3;
 constexpr int SCALE_ONEPAWN = 10;
 constexpr int SCALE_NORMAL = 32;
+constexpr int SCALE_NONE = -1;
 
 extern const Score isolated_penalty[2];
 extern const Score isolated_penaltyAH[2];
@@ -1092,7 +1378,6 @@ struct Parameter
 extern const int my_pieces[5][5];
 extern const int opponent_pieces[5][5];
 
-inline materialhashEntry* get_materialEntry(const Position& p) { return &p.my_thread->materialTable[p.materialhash & MATERIAL_HASH_SIZE_MASK]; }
 
 void init_imbalance();
 int qSearch(SearchThread* thread, searchInfo* info, int depth, int alpha, const int beta);
@@ -1277,6 +1562,8 @@ private:
 extern OpeningBook book;
 extern string openingBookPath;
 
+extern int startupTime;
+
 void bench();
 
 //Ethereal bench positions
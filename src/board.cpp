@@ -48,6 +48,7 @@ U64 colorMasks[64];
 int squareDistance[64][64];
 int reductions[2][64][64];
 uint8_t PopCnt16[1 << 16];
+bool use_popcnt = false;
 
 //Fancy Magic Bitboards
 U64 Battacks[5248];
@@ -56,11 +57,25 @@ U64 Rattacks[102400];
 SMagic mBishopTbl[64];
 SMagic mRookTbl[64];
 
+//PEXT/PDEP tables, used instead of the magics when the CPU has a fast PEXT
+uint16_t Battacks16[5248];
+uint16_t Rattacks16[102400];
+
+SPext mBishopPext[64];
+SPext mRookPext[64];
+
 void init_boards()
 {
     for (unsigned i = 0; i < (1 << 16); ++i)
         PopCnt16[i] = uint8_t(bitset<16>(i).count());
 
+#if defined(USE_POPCNT)
+    use_popcnt = true;
+#elif defined(POPCNT_DISPATCH)
+    __builtin_cpu_init();
+    use_popcnt = __builtin_cpu_supports("popcnt");
+#endif
+
     for (int i = 1; i < 64; i++)
         for (int j = 1; j < 64; j++)
     {
@@ -235,13 +250,27 @@ void init_boards()
         kingRing[i] = kingRing_temp[INDEX(r,f)];
     }
 
-    init_magics(Rattacks, mRookTbl, ROOK_MASKS, rookAttacks_slow, rookMagics);
-    init_magics(Battacks, mBishopTbl, BISHOP_MASKS, bishopAttacks_slow, bishopMagics);
+    use_pext = cpu_has_fast_pext();
+    if (use_pext)
+    {
+        init_pext(Rattacks16, mRookPext, ROOK_MASKS, rookAttacks_slow);
+        init_pext(Battacks16, mBishopPext, BISHOP_MASKS, bishopAttacks_slow);
+    }
+    else
+    {
+        init_magics(Rattacks, mRookTbl, ROOK_MASKS, rookAttacks_slow, rookMagics);
+        init_magics(Battacks, mBishopTbl, BISHOP_MASKS, bishopAttacks_slow, bishopMagics);
+    }
+
+    ///the PEXT tables expand their entries with these, so fill them in before any lookup
+    for (int i = 0; i < 64; i++)
+    {
+        PseudoAttacks[QUEEN][i] = PseudoAttacks[BISHOP][i] = bishopAttacks_slow(0, i);
+        PseudoAttacks[QUEEN][i] |= PseudoAttacks[ROOK][i] = rookAttacks_slow(0, i);
+    }
 
     for (int i = 0; i < 64; i++)
     {
-        PseudoAttacks[QUEEN][i] = PseudoAttacks[BISHOP][i] = bishopAttacks(0, i);
-        PseudoAttacks[QUEEN][i] |= PseudoAttacks[ROOK][i] = rookAttacks(0, i);
         for (int j = 0; j < 64; j++)
         {
             if (PseudoAttacks[ROOK][i] & BITSET(j))
@@ -0,0 +1,322 @@
+/*
+  Beef is a UCI-compliant chess engine.
+  Copyright (C) 2020 Jonathan Tseng.
+
+  Beef is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Beef is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Beef.h"
+
+#ifdef COPYMAKE
+
+static_assert(sizeof(CompactBoard) <= 128, "CompactBoard should fit in two cache lines");
+
+inline PieceType type_on(const CompactBoard& b, int sq)
+{
+    for (int pt = PAWN; pt <= KING; pt++)
+        if (b.pieces[pt] & BITSET(sq))
+            return PieceType(pt);
+    return BLANKTYPE;
+}
+
+// Pieces of side attacking sq under the given occupancy
+inline U64 attackers(const CompactBoard& b, int sq, Color side, U64 occ)
+{
+    return ((PAWN_ATTACKSFROM[side][sq] & b.pieces[PAWN])
+          | (PseudoAttacks[KNIGHT][sq] & b.pieces[KNIGHT])
+          | (PseudoAttacks[KING][sq] & b.pieces[KING])
+          | (bishopAttacks(occ, sq) & (b.pieces[BISHOP] | b.pieces[QUEEN]))
+          | (rookAttacks(occ, sq) & (b.pieces[ROOK] | b.pieces[QUEEN]))) & b.colors[side];
+}
+
+void compact_board(const Position& pos, CompactBoard* b)
+{
+    memset(b, 0, sizeof(CompactBoard));
+    for (int pt = PAWN; pt <= KING; pt++)
+        b->pieces[pt] = pos.pieceBB[make_piece(WHITE, PieceType(pt))] | pos.pieceBB[make_piece(BLACK, PieceType(pt))];
+    b->colors[WHITE] = pos.occupiedBB[WHITE];
+    b->colors[BLACK] = pos.occupiedBB[BLACK];
+    b->pieces[BLANKTYPE] = b->colors[WHITE] | b->colors[BLACK];
+    b->key = pos.key;
+    b->kingpos[WHITE] = pos.kingpos[WHITE];
+    b->kingpos[BLACK] = pos.kingpos[BLACK];
+    b->castleRights = pos.castleRights;
+    b->epSquare = pos.epSquare;
+    b->halfmoveClock = uint8_t(min(pos.halfmoveClock, 255));
+    b->activeSide = pos.activeSide;
+}
+
+/// Legal moves only: king moves are tested against the board without the king, pinned pieces
+/// stay on their line to the king, and in check everything else must capture or block.
+Move* generate_compact(const CompactBoard& b, Move* list)
+{
+    Color us = Color(b.activeSide);
+    Color them = ~us;
+    U64 occ = b.pieces[BLANKTYPE];
+    U64 mine = b.colors[us];
+    U64 enemies = b.colors[them];
+    int ksq = b.kingpos[us];
+    U64 checkers = attackers(b, ksq, them, occ);
+
+    U64 targets = PseudoAttacks[KING][ksq] & ~mine;
+    while (targets)
+    {
+        int to = popLsb(&targets);
+        if (!attackers(b, to, them, occ ^ BITSET(ksq)))
+            *list++ = makeMove(ksq, to, NORMAL);
+    }
+
+    if (MORETHANONE(checkers))
+        return list;
+
+    U64 target = checkers ? BETWEEN_MASKS[ksq][LSB(checkers)] | checkers : ~mine;
+
+    U64 pinned = 0ULL;
+    U64 snipers = ((PseudoAttacks[BISHOP][ksq] & (b.pieces[BISHOP] | b.pieces[QUEEN]))
+                 | (PseudoAttacks[ROOK][ksq] & (b.pieces[ROOK] | b.pieces[QUEEN]))) & enemies;
+    while (snipers)
+    {
+        U64 between = BETWEEN_MASKS[ksq][popLsb(&snipers)] & occ;
+        if (between && !MORETHANONE(between))
+            pinned |= between & mine;
+    }
+
+    for (int pt = KNIGHT; pt <= QUEEN; pt++)
+    {
+        U64 pieces = b.pieces[pt] & mine;
+        while (pieces)
+        {
+            int from = popLsb(&pieces);
+            U64 att = pt == KNIGHT ? PseudoAttacks[KNIGHT][from]
+                    : pt == BISHOP ? bishopAttacks(occ, from)
+                    : pt == ROOK ? rookAttacks(occ, from)
+                    : bishopAttacks(occ, from) | rookAttacks(occ, from);
+            att &= target;
+            if (pinned & BITSET(from))
+                att &= RAY_MASKS[ksq][from];
+            while (att)
+                *list++ = makeMove(from, popLsb(&att), NORMAL);
+        }
+    }
+
+    int up = us == WHITE ? NORTH : SOUTH;
+    U64 pawns = b.pieces[PAWN] & mine;
+    while (pawns)
+    {
+        int from = popLsb(&pawns);
+        U64 line = (pinned & BITSET(from)) ? RAY_MASKS[ksq][from] : ~0ULL;
+        U64 to_bb = PAWN_ATTACKS[us][from] & enemies;
+        int push = from + up;
+        if (!(occ & BITSET(push)))
+        {
+            to_bb |= BITSET(push);
+            if (RRANK(from, us) == 1 && !(occ & BITSET(push + up)))
+                to_bb |= BITSET(push + up);
+        }
+        to_bb &= target & line;
+
+        while (to_bb)
+        {
+            int to = popLsb(&to_bb);
+            if (RRANK(to, us) == 7)
+            {
+                *list++ = makePromotionMove(from, to, QUEEN, PROMOTION);
+                *list++ = makePromotionMove(from, to, KNIGHT, PROMOTION);
+                *list++ = makePromotionMove(from, to, ROOK, PROMOTION);
+                *list++ = makePromotionMove(from, to, BISHOP, PROMOTION);
+            }
+            else
+                *list++ = makeMove(from, to, NORMAL);
+        }
+
+        if (b.epSquare && (PAWN_ATTACKS[us][from] & BITSET(b.epSquare)))
+        {
+            ///Replay the capture on the occupancy: the king must not be attacked afterwards
+            int capturesquare = b.epSquare - up;
+            U64 after = (occ ^ BITSET(from) ^ BITSET(capturesquare)) | BITSET(b.epSquare);
+            if (!(attackers(b, ksq, them, after) & ~BITSET(capturesquare)))
+                *list++ = makeMove(from, b.epSquare, ENPASSANT);
+        }
+    }
+
+    if (!checkers)
+    {
+        for (int index = us * 2; index < us * 2 + 2; index++)
+        {
+            if ((b.castleRights & (WQCMASK << index)) == 0)
+                continue;
+            int rookFrom = castleRookFrom[index];
+            if (BETWEEN_MASKS[ksq][rookFrom] & occ)
+                continue;
+            U64 walk = castlekingwalk[index];
+            bool attacked = false;
+            while (!attacked && walk)
+                attacked = attackers(b, popLsb(&walk), them, occ);
+            if (!attacked)
+                *list++ = makeMove(ksq, rookFrom, CASTLING);
+        }
+    }
+
+    return list;
+}
+
+/// Writes the board after m into next; b itself is left as it was, so there is nothing to undo
+void copy_make(const CompactBoard& b, CompactBoard* next, Move m)
+{
+    *next = b;
+    Color us = Color(b.activeSide);
+    Color them = ~us;
+    int from = from_sq(m);
+    int to = to_sq(m);
+    SpecialType type = type_of(m);
+    U64 key = b.key ^ zb.activeSide ^ zb.epSquares[b.epSquare];
+    int eptnew = 0;
+    if (next->halfmoveClock < 255) // saturate rather than wrap, anything past 100 plies is a draw anyway
+        next->halfmoveClock++;
+
+    if (type == CASTLING)
+    {
+        int castleType = 2 * us + ((to > from) ? 1 : 0);
+        int kingTo = castleKingTo[castleType];
+        int rookTo = castleRookTo[castleType];
+        PieceCode kingpc = make_piece(us, KING);
+        PieceCode rookpc = make_piece(us, ROOK);
+        U64 kingMove = BITSET(from) | BITSET(kingTo);
+        U64 rookMove = BITSET(to) | BITSET(rookTo);
+
+        next->pieces[KING] ^= kingMove;
+        next->pieces[ROOK] ^= rookMove;
+        next->colors[us] ^= kingMove ^ rookMove;
+        next->kingpos[us] = kingTo;
+        key ^= zb.pieceKeys[(from << 4) | kingpc] ^ zb.pieceKeys[(kingTo << 4) | kingpc];
+        key ^= zb.pieceKeys[(to << 4) | rookpc] ^ zb.pieceKeys[(rookTo << 4) | rookpc];
+        next->castleRights &= (us ? ~(BQCMASK | BKCMASK) : ~(WQCMASK | WKCMASK));
+    }
+    else
+    {
+        PieceType pt = type_on(b, from);
+        PieceCode pc = make_piece(us, pt);
+        U64 fromTo = BITSET(from) | BITSET(to);
+
+        if (type == ENPASSANT)
+        {
+            int capturesquare = (from & 0x38) | (to & 0x07);
+            next->pieces[PAWN] ^= BITSET(capturesquare);
+            next->colors[them] ^= BITSET(capturesquare);
+            key ^= zb.pieceKeys[(capturesquare << 4) | make_piece(them, PAWN)];
+        }
+        else if (b.colors[them] & BITSET(to))
+        {
+            PieceType captured = type_on(b, to);
+            next->pieces[captured] ^= BITSET(to);
+            next->colors[them] ^= BITSET(to);
+            key ^= zb.pieceKeys[(to << 4) | make_piece(them, captured)];
+            next->halfmoveClock = 0;
+        }
+
+        next->colors[us] ^= fromTo;
+        if (type == PROMOTION)
+        {
+            PieceType promotion = promotion_type(m);
+            next->pieces[PAWN] ^= BITSET(from);
+            next->pieces[promotion] ^= BITSET(to);
+            key ^= zb.pieceKeys[(from << 4) | pc] ^ zb.pieceKeys[(to << 4) | make_piece(us, promotion)];
+        }
+        else
+        {
+            next->pieces[pt] ^= fromTo;
+            key ^= zb.pieceKeys[(from << 4) | pc] ^ zb.pieceKeys[(to << 4) | pc];
+        }
+
+        if (pt == PAWN)
+        {
+            next->halfmoveClock = 0;
+            if ((to ^ from) == 16 && (epthelper[to] & b.pieces[PAWN] & b.colors[them])) // double push w/ possible EP
+                eptnew = (to + from) / 2;
+        }
+        else if (pt == KING)
+            next->kingpos[us] = to;
+
+        next->castleRights &= (castlerights[from] & castlerights[to]);
+    }
+
+    next->pieces[BLANKTYPE] = next->colors[WHITE] | next->colors[BLACK];
+    next->epSquare = eptnew;
+    next->activeSide = them;
+    next->key = key ^ zb.epSquares[eptnew] ^ zb.castle[b.castleRights] ^ zb.castle[next->castleRights];
+}
+
+U64 perft_compact(const CompactBoard& b, int depth, bool bulk)
+{
+    if (depth == 0)
+        return 1;
+
+    Move list[256];
+    Move* end = generate_compact(b, list);
+    if (bulk && depth == 1)
+        return end - list;
+
+    U64 nodes = 0;
+    for (Move* m = list; m < end; m++)
+    {
+        CompactBoard next;
+        copy_make(b, &next, *m);
+        nodes += perft_compact(next, depth - 1, bulk);
+    }
+    return nodes;
+}
+
+static U64 perft_make_unmake(Position& pos, int depth, bool bulk)
+{
+    if (depth == 0)
+        return 1;
+
+    MoveList<ALL> moves(pos);
+    if (bulk && depth == 1)
+        return moves.size();
+
+    U64 nodes = 0;
+    for (const auto& m : moves)
+    {
+        pos.do_move(m);
+        nodes += perft_make_unmake(pos, depth - 1, bulk);
+        pos.undo_move(m);
+    }
+    return nodes;
+}
+
+/// Perft on Position (make/unmake) and on CompactBoard (copy-make), with and without bulk counting
+/// at the last ply. Without it every leaf is made, which is where the state handling shows.
+void copymake_perft(Position& pos, int depth)
+{
+    CompactBoard root;
+    compact_board(pos, &root);
+
+    for (int bulk = 1; bulk >= 0; bulk--)
+    {
+        int start = getRealTime();
+        U64 nodes = perft_make_unmake(pos, depth, bulk);
+        int t1 = getRealTime() - start;
+
+        start = getRealTime();
+        U64 compactNodes = perft_compact(root, depth, bulk);
+        int t2 = getRealTime() - start;
+
+        cout << (bulk ? "bulk counted" : "every leaf made") << endl;
+        cout << "  make/unmake (Position, " << sizeof(Position) << " bytes): " << nodes << " nodes, " << t1 << " ms" << endl;
+        cout << "  copy-make (CompactBoard, " << sizeof(CompactBoard) << " bytes): " << compactNodes << " nodes, " << t2 << " ms" << endl;
+    }
+}
+
+#endif // COPYMAKE
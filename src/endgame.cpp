@@ -0,0 +1,383 @@
+/*
+  Beef is a UCI-compliant chess engine.
+  Copyright (C) 2020 Jonathan Tseng.
+
+  Beef is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Beef is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Beef.h"
+
+/// KPK bitbase: one bit per (side to move, kings, pawn) with the pawn on files a-d and ranks 2-7,
+/// set when the side with the pawn wins. 2 * 64 * 64 * 24 positions -> 24 KB.
+
+constexpr int KPK_SIZE = 2 * 64 * 64 * 24;
+
+static uint32_t kpkBitbase[KPK_SIZE / 32];
+
+enum KPKResult : uint8_t { KPK_INVALID = 0, KPK_UNKNOWN = 1, KPK_DRAW = 2, KPK_WIN = 4 };
+
+inline int kpk_index(Color stm, int bk, int wk, int pawnSq)
+{
+    return wk | (bk << 6) | (stm << 12) | (FILE(pawnSq) << 13) | ((6 - RANK(pawnSq)) << 15);
+}
+
+static uint8_t kpk_initial(int idx, int& wk, int& bk, Color& stm, int& pawnSq)
+{
+    wk = idx & 63;
+    bk = (idx >> 6) & 63;
+    stm = Color((idx >> 12) & 1);
+    pawnSq = INDEX((6 - (idx >> 15)), ((idx >> 13) & 3));
+
+    if (squareDistance[wk][bk] <= 1 || wk == pawnSq || bk == pawnSq
+        || (stm == WHITE && (PAWN_ATTACKS[WHITE][pawnSq] & BITSET(bk))))
+        return KPK_INVALID;
+
+    // White to move can promote without the black king taking the new queen
+    if (stm == WHITE && RANK(pawnSq) == 6 && wk != pawnSq + 8 && bk != pawnSq + 8
+        && (squareDistance[bk][pawnSq + 8] > 1 || squareDistance[wk][pawnSq + 8] == 1))
+        return KPK_WIN;
+
+    // Black to move is stalemated, or takes an undefended pawn
+    if (stm == BLACK && (!(PseudoAttacks[KING][bk] & ~(PseudoAttacks[KING][wk] | PAWN_ATTACKS[WHITE][pawnSq]))
+        || (PseudoAttacks[KING][bk] & ~PseudoAttacks[KING][wk] & BITSET(pawnSq))))
+        return KPK_DRAW;
+
+    return KPK_UNKNOWN;
+}
+
+static uint8_t kpk_classify(const uint8_t* db, int wk, int bk, Color stm, int pawnSq)
+{
+    // White needs one winning successor, black needs one drawing successor
+    const uint8_t good = stm == WHITE ? KPK_WIN : KPK_DRAW;
+    const uint8_t bad = stm == WHITE ? KPK_DRAW : KPK_WIN;
+
+    uint8_t r = KPK_INVALID;
+    U64 b = PseudoAttacks[KING][stm == WHITE ? wk : bk];
+
+    while (b)
+    {
+        int s = popLsb(&b);
+        r |= stm == WHITE ? db[kpk_index(BLACK, bk, s, pawnSq)] : db[kpk_index(WHITE, s, wk, pawnSq)];
+    }
+
+    if (stm == WHITE)
+    {
+        if (RANK(pawnSq) < 6)
+            r |= db[kpk_index(BLACK, bk, wk, pawnSq + 8)];
+        if (RANK(pawnSq) == 1 && pawnSq + 8 != wk && pawnSq + 8 != bk)
+            r |= db[kpk_index(BLACK, bk, wk, pawnSq + 16)];
+    }
+
+    return (r & good) ? good : (r & KPK_UNKNOWN) ? uint8_t(KPK_UNKNOWN) : bad;
+}
+
+static void init_kpk()
+{
+    vector<uint8_t> db(KPK_SIZE);
+    int wk, bk, pawnSq;
+    Color stm;
+
+    for (int idx = 0; idx < KPK_SIZE; idx++)
+        db[idx] = kpk_initial(idx, wk, bk, stm, pawnSq);
+
+    // Retrograde iteration: resolve positions whose successors are known until nothing changes
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int idx = 0; idx < KPK_SIZE; idx++)
+        {
+            if (db[idx] != KPK_UNKNOWN)
+                continue;
+            kpk_initial(idx, wk, bk, stm, pawnSq);
+            if ((db[idx] = kpk_classify(db.data(), wk, bk, stm, pawnSq)) != KPK_UNKNOWN)
+                changed = true;
+        }
+    }
+
+    for (int idx = 0; idx < KPK_SIZE; idx++)
+        if (db[idx] == KPK_WIN)
+            kpkBitbase[idx >> 5] |= 1u << (idx & 31);
+}
+
+/// Built the first time a KPK position is evaluated, most processes never need it
+static std::once_flag kpkOnce;
+
+static bool kpk_probe(int wk, int pawnSq, int bk, Color stm)
+{
+    std::call_once(kpkOnce, init_kpk);
+    int idx = kpk_index(stm, bk, wk, pawnSq);
+    return kpkBitbase[idx >> 5] & (1u << (idx & 31));
+}
+
+/// Helpers for driving the kings around in won endgames
+
+inline int push_to_edge(int sq)
+{
+    int fd = min(FILE(sq), 7 - FILE(sq));
+    int rd = min(RANK(sq), 7 - RANK(sq));
+    return 90 - (7 * fd * fd + 7 * rd * rd) / 2;
+}
+
+inline int push_close(int s1, int s2) { return 140 - 20 * squareDistance[s1][s2]; }
+
+inline int from_strong(const Position& pos, Color strongSide, int v) { return pos.activeSide == strongSide ? v : -v; }
+
+/// Evaluation functions. Each returns a score from the side to move's point of view.
+
+// Mating material against a bare king: drive the king to the edge and bring ours close
+int KXK(const Position& pos, Color strongSide)
+{
+    Color weakSide = ~strongSide;
+
+    // Avoid stalemating with a lone king to move
+    if (pos.activeSide == weakSide && !pos.checkBB && !MoveList<ALL>(pos).size())
+        return 0;
+
+    int wk = pos.kingpos[weakSide], sk = pos.kingpos[strongSide];
+    int v = pos.nonPawn[strongSide] + pos.pieceCount[WPAWN + strongSide] * PAWN_EG
+        + push_to_edge(wk) + push_close(sk, wk);
+
+    if (pos.pieceBB[WQUEEN + strongSide] || pos.pieceBB[WROOK + strongSide]
+        || (pos.pieceBB[WBISHOP + strongSide] && pos.pieceBB[WKNIGHT + strongSide])
+        || ((pos.pieceBB[WBISHOP + strongSide] & DarkSquares) && (pos.pieceBB[WBISHOP + strongSide] & ~DarkSquares)))
+        v += WON_ENDGAME;
+
+    return from_strong(pos, strongSide, min(v, WON_ENDGAME + 2000));
+}
+
+// Bishop and knight: drive the king to a corner of the bishop's colour
+int KBNK(const Position& pos, Color strongSide)
+{
+    bool darkBishop = (pos.pieceBB[WBISHOP + strongSide] & DarkSquares);
+    int sk = pos.kingpos[strongSide] ^ (darkBishop ? 0 : 56);
+    int wk = pos.kingpos[~strongSide] ^ (darkBishop ? 0 : 56);
+    int kingDistance = 7 - squareDistance[wk][sk];
+    int cornerDistance = abs(7 - RANK(wk) - FILE(wk));
+
+    return from_strong(pos, strongSide, WON_ENDGAME + 420 * cornerDistance + 20 * kingDistance);
+}
+
+// King and pawn against king, looked up in the bitbase
+int KPK(const Position& pos, Color strongSide)
+{
+    // Normalize so that the strong side is white with the pawn on files a-d
+    int flip = strongSide == WHITE ? 0 : 56;
+    int pawnSq = LSB(pos.pieceBB[WPAWN + strongSide]) ^ flip;
+    int mirror = FILE(pawnSq) >= 4 ? 7 : 0;
+    int wk = pos.kingpos[strongSide] ^ flip ^ mirror;
+    int bk = pos.kingpos[~strongSide] ^ flip ^ mirror;
+    pawnSq ^= mirror;
+    Color stm = pos.activeSide == strongSide ? WHITE : BLACK;
+
+    if (!kpk_probe(wk, pawnSq, bk, stm))
+        return 0;
+
+    return from_strong(pos, strongSide, WON_ENDGAME + PAWN_EG + 20 * RANK(pawnSq));
+}
+
+// Queen against pawn: a win unless the pawn is on the seventh on a rook or bishop file, next to its king
+int KQKP(const Position& pos, Color strongSide)
+{
+    Color weakSide = ~strongSide;
+    int wk = pos.kingpos[weakSide], sk = pos.kingpos[strongSide];
+    int pawnSq = LSB(pos.pieceBB[WPAWN + weakSide]);
+    int v = push_close(sk, wk);
+
+    if (RRANK(pawnSq, weakSide) != 6 || squareDistance[wk][pawnSq] != 1
+        || !((FileABB | FileCBB | FileFBB | FileHBB) & BITSET(pawnSq)))
+        v += QUEEN_EG - PAWN_EG;
+
+    return from_strong(pos, strongSide, v);
+}
+
+// Queen against rook: winning, drive the king to the edge
+int KQKR(const Position& pos, Color strongSide)
+{
+    int wk = pos.kingpos[~strongSide], sk = pos.kingpos[strongSide];
+    return from_strong(pos, strongSide, QUEEN_EG - ROOK_EG + push_to_edge(wk) + push_close(sk, wk));
+}
+
+// Rook against pawn: decided by how far the kings are from the pawn's path
+int KRKP(const Position& pos, Color strongSide)
+{
+    Color weakSide = ~strongSide;
+    // Relative to the strong side, so the pawn runs towards rank 1
+    int flip = strongSide == WHITE ? 0 : 56;
+    int sk = pos.kingpos[strongSide] ^ flip;
+    int wk = pos.kingpos[weakSide] ^ flip;
+    int rsq = LSB(pos.pieceBB[WROOK + strongSide]) ^ flip;
+    int pawnSq = LSB(pos.pieceBB[WPAWN + weakSide]) ^ flip;
+    int queeningSq = FILE(pawnSq);
+    int v;
+
+    if (FILE(sk) == FILE(pawnSq) && sk < pawnSq)
+        v = ROOK_EG - squareDistance[sk][pawnSq];
+    else if (squareDistance[wk][pawnSq] >= 3 + (pos.activeSide == weakSide) && squareDistance[wk][rsq] >= 3)
+        v = ROOK_EG - squareDistance[sk][pawnSq];
+    else if (RANK(wk) <= 2 && squareDistance[wk][pawnSq] == 1 && RANK(sk) >= 3
+        && squareDistance[sk][pawnSq] > 2 + (pos.activeSide == strongSide))
+        v = 80 - 8 * squareDistance[sk][pawnSq];
+    else
+        v = 200 - 8 * (squareDistance[sk][pawnSq - 8] - squareDistance[wk][pawnSq - 8] - squareDistance[pawnSq][queeningSq]);
+
+    return from_strong(pos, strongSide, v);
+}
+
+/// Scale functions. Each returns a scale factor out of SCALE_NORMAL, or SCALE_NONE to fall back
+/// to Position::scaleFactor().
+
+// Bishop and rook pawns where the bishop does not control the queening square
+int KBPsK(const Position& pos, Color strongSide)
+{
+    Color weakSide = ~strongSide;
+    U64 pawns = pos.pieceBB[WPAWN + strongSide];
+    U64 file = (pawns & ~FileABB) ? FileHBB : FileABB;
+
+    if (pawns & ~file)
+        return SCALE_NONE;
+
+    int queeningSq = (strongSide == WHITE ? 56 : 0) | FILE(LSB(file));
+    bool bishopOnQueening = !(pos.pieceBB[WBISHOP + strongSide] & DarkSquares) == !(BITSET(queeningSq) & DarkSquares);
+
+    if (!bishopOnQueening && squareDistance[pos.kingpos[weakSide]][queeningSq] <= 1)
+        return 0;
+
+    return SCALE_NONE;
+}
+
+// Pawns on a single rook file against a bare king standing in front of them
+int KPsK(const Position& pos, Color strongSide)
+{
+    Color weakSide = ~strongSide;
+    U64 pawns = pos.pieceBB[WPAWN + strongSide];
+    int wk = pos.kingpos[weakSide];
+
+    if (((pawns & ~FileABB) && (pawns & ~FileHBB)) || abs(FILE(wk) - FILE(LSB(pawns))) > 1)
+        return SCALE_NONE;
+
+    int front = strongSide == WHITE ? MSB(pawns) : LSB(pawns);
+    if (RRANK(wk, strongSide) > RRANK(front, strongSide))
+        return 0;
+
+    return SCALE_NONE;
+}
+
+/// Table of the functions above. Material entries refer to them by index so that the entries stay
+/// small; index 0 means there is no function.
+
+enum EndgameId : uint8_t { EG_NONE, EG_KXK, EG_KBNK, EG_KPK, EG_KQKP, EG_KQKR, EG_KRKP, EG_KBPSK, EG_KPSK };
+
+const EndgameFunction endgameFunctions[] = { nullptr, &KXK, &KBNK, &KPK, &KQKP, &KQKR, &KRKP, &KBPsK, &KPsK };
+
+/// Registry of endgames keyed by material signature
+
+struct endgameEntry
+{
+    U64 key;
+    Color strongSide;
+    uint8_t evaluation;
+};
+
+static vector<endgameEntry> endgames;
+static int endgameMaxPieces; // most pieces, kings included, in any registered signature
+
+// Material key of a signature like "KRvKP", computed the same way as Position::materialhash
+static U64 material_key(const string& code, Color strongSide)
+{
+    int counts[14] = {};
+    size_t split = code.find('v');
+
+    for (size_t i = 0; i < code.size(); i++)
+    {
+        if (i == split)
+            continue;
+        Color c = (i < split) == (strongSide == WHITE) ? WHITE : BLACK;
+        PieceType pt = string("PNBRQK").find(code[i]) == string::npos ? BLANKTYPE : PieceType(string("PNBRQK").find(code[i]) + 1);
+        counts[(pt << 1) | c]++;
+    }
+
+    return materialKey(counts);
+}
+
+static void add_endgame(const string& code, EndgameId evaluation)
+{
+    endgameMaxPieces = max(endgameMaxPieces, int(code.size()) - 1);
+    endgames.push_back({ material_key(code, WHITE), WHITE, evaluation });
+    endgames.push_back({ material_key(code, BLACK), BLACK, evaluation });
+}
+
+void init_endgames()
+{
+    add_endgame("KBNvK", EG_KBNK);
+#ifndef __TUNE__
+    add_endgame("KPvK", EG_KPK);
+    add_endgame("KQvKP", EG_KQKP);
+    add_endgame("KQvKR", EG_KQKR);
+    add_endgame("KRvKP", EG_KRKP);
+#endif
+}
+
+// Fill in the specialized evaluation or scale function for a material configuration, if any
+void probe_endgame(const int* pieceCount, materialEntry* material)
+{
+    int pieces = 0;
+    for (int pc = WPAWN; pc <= BKING; pc++)
+        pieces += pieceCount[pc];
+
+    if (pieces <= endgameMaxPieces)
+    {
+        U64 key = materialKey(pieceCount);
+
+        for (const endgameEntry& e : endgames)
+        {
+            if (e.key == key)
+            {
+                material->evaluation = e.evaluation;
+                material->strongSide = e.strongSide;
+                return;
+            }
+        }
+    }
+
+#ifndef __TUNE__
+    int nonPawn[2] = {};
+    for (int pc = WKNIGHT; pc <= BQUEEN; pc++)
+        nonPawn[pc & 1] += pieceCount[pc] * nonPawnValue[pc];
+
+    for (Color c : { WHITE, BLACK })
+    {
+        Color weak = ~c;
+        bool bareWeak = !nonPawn[weak] && !pieceCount[WPAWN + weak];
+
+        if (bareWeak && nonPawn[c] >= ROOK_MG)
+        {
+            material->evaluation = EG_KXK;
+            material->strongSide = c;
+            return;
+        }
+
+        if (!nonPawn[weak] && nonPawn[c] == BISHOP_MG && pieceCount[WBISHOP + c] == 1 && pieceCount[WPAWN + c])
+        {
+            material->scaling = EG_KBPSK;
+            material->strongSide = c;
+        }
+        else if (bareWeak && !nonPawn[c] && pieceCount[WPAWN + c] > 1)
+        {
+            material->scaling = EG_KPSK;
+            material->strongSide = c;
+        }
+    }
+#endif
+}
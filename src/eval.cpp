@@ -176,96 +176,97 @@ template <Tracing T> void Eval<T>::evaluate_pawns()
 
 template <Tracing T> template <Color side> void Eval<T>::evaluate_pawn_structure() //get pawn score and find the passed pawns
 {
+    // Each property is computed for all pawns at once and scored by popcount. The per-pawn
+    // loop this replaces popped myPawns as it went, so a pawn's own-pawn relations only saw
+    // pawns on higher squares: higher ranks, or the right-hand neighbour on its own rank.
+    // The sets below keep that, which keeps the pawn hash contents (and the tuned weights) as they were.
     Score pawnStructure = S(0, 0);
-    Color us = (side) ? BLACK : WHITE;
-    Color them = ~us;
+    constexpr Color us = side;
+    constexpr Color them = ~side;
     U64 myPawns = pos.pieceBB[make_piece(us, PAWN)];
     U64 theirPawns = pos.pieceBB[make_piece(them, PAWN)];
-    int sq, fwd1, fwd2;
-    bool opposed, isolated, doubled, backward;
-    U64 phalanx, supported, forward_threats;
-    pawntte->passedPawns[us] = 0ULL;
-    pawntte->attackSpans[us] = 0ULL;
-    pawntte->semiopenFiles[us] = 0xFF;
-    while (myPawns)
-    {
-        sq = popLsb(&myPawns);
-        pawntte->attackSpans[us] |= (passedPawnMasks[us][sq] ^ pawnBlockerMasks[us][sq]);
-
-        fwd1 = PAWNPUSHINDEX(us, sq);
-        fwd2 = PAWNPUSHINDEX(us, fwd1);
-        opposed = (pawnBlockerMasks[us][sq] & theirPawns) != 0ULL;
-        isolated = (neighborMasks[sq] & myPawns) == 0ULL;
-        doubled = (pawnBlockerMasks[us][sq] & myPawns) != 0ULL;
-        forward_threats = (PAWN_ATTACKS[us][fwd1] & theirPawns);
-        backward = !(passedPawnMasks[them][sq] & myPawns) && forward_threats;
-        phalanx = phalanxMasks[sq] & myPawns;
-        supported = PAWN_ATTACKS[them][sq] & myPawns;
+    U64 theirAttacks = PAWNATTACKS(them, theirPawns);
+    U64 defended = attackedSquares[make_piece(side, PAWN)];
+    U64 rightNeighbour = myPawns & shift<WEST>(myPawns);
+
+    U64 opposed = myPawns & rear_span<us>(theirPawns);
+    U64 isolated = myPawns & ~(rear_span<WHITE>(adjacent_files(myPawns)) | shift<WEST>(myPawns));
+    U64 doubled = us == WHITE ? myPawns & rear_span<WHITE>(myPawns) : 0ULL;
+    U64 threatened = myPawns & (us == WHITE ? theirAttacks >> 8 : theirAttacks << 8); //the push square is attacked
+    U64 backward = us == WHITE ? threatened : threatened & ~front_span<BLACK>(myPawns | adjacent_files(myPawns));
+    U64 phalanx = rightNeighbour;
+    U64 supported = us == WHITE ? 0ULL : myPawns & PAWNATTACKS(BLACK, myPawns);
 
-        #if TUNERTRACE
-        Trace.piece_bonus[side][PAWN][FLIP_SQUARE(side, sq)]++;
-        Trace.piece_values[side][PAWN]++;
-        #endif // TUNERTRACE
+    #if TUNERTRACE
+    U64 tracePawns = myPawns;
+    while (tracePawns)
+        Trace.piece_bonus[side][PAWN][FLIP_SQUARE(side, popLsb(&tracePawns))]++;
+    Trace.piece_values[side][PAWN] += POPCOUNT(myPawns);
+    #endif // TUNERTRACE
 
-        if (isolated)
-        {
-            pawnStructure -= (BITSET(sq) & FileAH) ? isolated_penaltyAH[opposed] : isolated_penalty[opposed];
-            #if TUNERTRACE
-            if (BITSET(sq) & FileAH)
-                Trace.isolated_penaltyAH[side][opposed]--;
-            else
-                Trace.isolated_penalty[side][opposed]--;
-            #endif // TUNERTRACE
-        }
+    for (int o = 0; o <= 1; o++)
+    {
+        U64 group = o ? opposed : myPawns & ~opposed;
+        U64 b;
 
-        if (backward)
-        {
-            pawnStructure -= backward_penalty[opposed];
-            #if TUNERTRACE
-            Trace.backward_penalty[side][opposed]--;
-            #endif // TUNERTRACE
-        }
+        b = isolated & group;
+        pawnStructure -= isolated_penaltyAH[o] * POPCOUNT(b & FileAH) + isolated_penalty[o] * POPCOUNT(b & ~FileAH);
 
-        if (doubled)
-        {
-            pawnStructure -= (BITSET(sq) & attackedSquares[make_piece(side, PAWN)]) ? doubled_penalty[opposed] : doubled_penalty_undefended[opposed];
-            #if TUNERTRACE
-            if (BITSET(sq) & attackedSquares[make_piece(side, PAWN)])
-                Trace.doubled_penalty[side][opposed]--;
-            else
-                Trace.doubled_penalty_undefended[side][opposed]--;
-            #endif // TUNERTRACE
-        }
+        b = backward & group;
+        pawnStructure -= backward_penalty[o] * POPCOUNT(b);
 
-        if (isolated && doubled)
-        {
-            pawnStructure -= (BITSET(sq) & FileAH) ? isolated_doubled_penaltyAH[opposed] : isolated_doubled_penalty[opposed];
-            #if TUNERTRACE
-            if (BITSET(sq) & FileAH)
-                Trace.isolated_doubled_penaltyAH[side][opposed]--;
-            else
-                Trace.isolated_doubled_penalty[side][opposed]--;
-            #endif // TUNERTRACE
-        }
+        b = doubled & group;
+        pawnStructure -= doubled_penalty[o] * POPCOUNT(b & defended) + doubled_penalty_undefended[o] * POPCOUNT(b & ~defended);
+
+        b = isolated & doubled & group;
+        pawnStructure -= isolated_doubled_penaltyAH[o] * POPCOUNT(b & FileAH) + isolated_doubled_penalty[o] * POPCOUNT(b & ~FileAH);
 
-        if (phalanx | supported)
+        #if TUNERTRACE
+        Trace.isolated_penaltyAH[side][o] -= POPCOUNT(isolated & group & FileAH);
+        Trace.isolated_penalty[side][o] -= POPCOUNT(isolated & group & ~FileAH);
+        Trace.backward_penalty[side][o] -= POPCOUNT(backward & group);
+        Trace.doubled_penalty[side][o] -= POPCOUNT(doubled & group & defended);
+        Trace.doubled_penalty_undefended[side][o] -= POPCOUNT(doubled & group & ~defended);
+        Trace.isolated_doubled_penaltyAH[side][o] -= POPCOUNT(isolated & doubled & group & FileAH);
+        Trace.isolated_doubled_penalty[side][o] -= POPCOUNT(isolated & doubled & group & ~FileAH);
+        #endif // TUNERTRACE
+
+        for (int ph = 0; ph <= 1; ph++)
         {
-            pawnStructure += connected_bonus[opposed][bool(phalanx)][RRANK(sq, us)];
-            #if TUNERTRACE
-            Trace.connected_bonus[side][opposed][bool(phalanx)][RRANK(sq,us)]++;
-            #endif // TUNERTRACE
+            b = group & (ph ? phalanx : supported & ~phalanx);
+            for (int r = 1; b && r < 7; r++)
+            {
+                U64 onRank = b & RankBB[us == WHITE ? r : 7 - r];
+                b ^= onRank;
+                if (onRank)
+                {
+                    pawnStructure += connected_bonus[o][ph][r] * POPCOUNT(onRank);
+                    #if TUNERTRACE
+                    Trace.connected_bonus[side][o][ph][r] += POPCOUNT(onRank);
+                    #endif // TUNERTRACE
+                }
+            }
         }
+    }
 
-
-        if (!opposed &&
-            (!(passedPawnMasks[us][fwd1] & theirPawns)
-                || ((passedPawnMasks[us][fwd2] & theirPawns)
-                    && (POPCOUNT(phalanx) >= POPCOUNT(forward_threats)))
-                ))
-            pawntte->passedPawns[us] |= BITSET(sq);
-        pawntte->semiopenFiles[us] &= ~(1 << FILE(sq));
+    // unopposed pawns with no enemy pawn ahead on adjacent files from the push square on are passed;
+    // the rest only qualify as candidates that can trade off their single remaining sentry
+    U64 sentries = rear_span<us>(theirPawns | adjacent_files(theirPawns));
+    U64 unopposed = myPawns & ~opposed;
+    U64 passed = unopposed & ~(us == WHITE ? sentries >> 8 : sentries << 8);
+    U64 candidates = unopposed ^ passed;
+    while (candidates)
+    {
+        int sq = popLsb(&candidates);
+        int fwd2 = PAWNPUSHINDEX(us, PAWNPUSHINDEX(us, sq));
+        if ((passedPawnMasks[us][fwd2] & theirPawns)
+            && bool(rightNeighbour & BITSET(sq)) >= POPCOUNT(PAWN_ATTACKS[us][PAWNPUSHINDEX(us, sq)] & theirPawns))
+            passed |= BITSET(sq);
     }
 
+    pawntte->passedPawns[us] = passed;
+    pawntte->attackSpans[us] = front_span<us>(adjacent_files(myPawns));
+    pawntte->semiopenFiles[us] = 0xFF & ~uint8_t(file_fill(myPawns));
     pawntte->scores[us] = pawnStructure;
 }
 
@@ -330,7 +331,7 @@ template <Tracing T> template <Color side> Score Eval<T>::evaluate_passers()
     return out;
 }
 
-template <Tracing T> template <Color side> Score Eval<T>::king_safety() const
+template <Tracing T> template <Color side, int V> Score Eval<T>::king_safety() const
 {
     //king danger for white, e.g. = attacks on white king - safety features for white king
     // attacks = flank attacks/double attacks + safe checks + king ring attacks + pawn storm
@@ -342,7 +343,9 @@ template <Tracing T> template <Color side> Score Eval<T>::king_safety() const
     int pawn_shelter = pawntte->pawnShelter[side];
     outMG += pawn_shelter;
 
-    if (king_attackers_count[side] > (1 - pos.pieceCount[make_piece(opponent, QUEEN)]))
+    int opponentQueens = (V & EVAL_NO_QUEENS) ? 0 : pos.pieceCount[make_piece(opponent, QUEEN)];
+
+    if (king_attackers_count[side] > (1 - opponentQueens))
     {
         U64 weak = attackedSquares[opponent]
             & ~double_targets[side]
@@ -351,7 +354,7 @@ template <Tracing T> template <Color side> Score Eval<T>::king_safety() const
         //the higher this number, the worse for [side]
         int king_danger = kingDangerBase
             - pawn_shelter * kingShieldBonus / 10
-            - !pos.pieceCount[make_piece(opponent, QUEEN)] * noQueen
+            - !opponentQueens * noQueen
             + king_attackers_count[side] * king_attackers_weight[side]
             + king_attacks_count[side] * kingringAttack
             + bool(pos.blockersForKing[side]) * kingpinnedPenalty
@@ -375,7 +378,7 @@ template <Tracing T> template <Color side> Score Eval<T>::king_safety() const
 
         U64 queenChecks, rookChecks, bishopChecks, knightChecks;
 
-        rookChecks = ((rookSquares)&attackedSquares[make_piece(opponent, ROOK)]);
+        rookChecks = (V & EVAL_NO_ROOKS) ? 0ULL : ((rookSquares)&attackedSquares[make_piece(opponent, ROOK)]);
         if (rookChecks)
         {
             king_danger += (rookChecks & safe) ? checkPenalty[ROOK] : unsafeCheckPenalty[ROOK];
@@ -387,7 +390,7 @@ template <Tracing T> template <Color side> Score Eval<T>::king_safety() const
             #endif // TUNERTRACE
         }
 
-        queenChecks = ((rookSquares | bishopSquares)
+        queenChecks = (V & EVAL_NO_QUEENS) ? 0ULL : ((rookSquares | bishopSquares)
             & attackedSquares[make_piece(opponent, QUEEN)]
             & ~attackedSquares[make_piece(side, QUEEN)]
             & ~rookChecks);
@@ -456,7 +459,7 @@ template <Tracing T> template <Color side> Score Eval<T>::king_safety() const
     safetyTrace.dangerScore[side] = out;
     #endif // TUNERTRACE
 
-    if (pos.pieceBB[make_piece(side, PAWN)])
+    if (!(V & EVAL_PAWNLESS) && pos.pieceBB[make_piece(side, PAWN)])
     {
         int distance = 0;
         while (!(distanceRings[kingSquare][distance++] & pos.pieceBB[make_piece(side, PAWN)])) {}
@@ -482,6 +485,44 @@ template <Tracing T> template <Color side> Score Eval<T>::king_safety() const
     return out;
 }
 
+// Batch the attacks of all bishops, rooks and queens through the AVX2 kernel, with the same
+// x-ray occupancies evaluate_piece() uses: bishops see through queens, rooks through queens and
+// their own rooks.
+template <Tracing T> void Eval<T>::slider_attacks()
+{
+    U64 occ = pos.occupiedBB[0] | pos.occupiedBB[1];
+    U64 noQueens = occ ^ pos.pieceBB[WQUEEN] ^ pos.pieceBB[BQUEEN];
+    int squares[16] = {};
+    U64 occs[16] = {}, out[16];
+    int n;
+
+    for (int pass = 0; pass < 3; pass++)
+    {
+        ///promotions can leave more sliders of one kind than the kernel batch holds, so flush every 16
+        auto flush = [&]() {
+            slider_attacks_avx2(squares, occs, out, n, pass != 1, pass != 0);
+            for (int i = 0; i < n; i++)
+                sliderAttacks[squares[i]] = out[i];
+            n = 0;
+        };
+        n = 0;
+        for (int side = WHITE; side <= BLACK; side++)
+        {
+            U64 pieces = pos.pieceBB[make_piece(Color(side), pass == 0 ? BISHOP : pass == 1 ? ROOK : QUEEN)];
+            U64 o = pass == 0 ? noQueens : pass == 1 ? noQueens ^ pos.pieceBB[make_piece(Color(side), ROOK)] : occ;
+            while (pieces)
+            {
+                squares[n] = popLsb(&pieces);
+                occs[n++] = o;
+                if (n == 16)
+                    flush();
+            }
+        }
+        if (n)
+            flush();
+    }
+}
+
 template <Tracing T> template <Color side, PieceType type> Score Eval<T>::evaluate_piece()
 {
     Score out = S(0, 0);
@@ -496,9 +537,12 @@ template <Tracing T> template <Color side, PieceType type> Score Eval<T>::evalua
     while (pieces)
     {
         sq = popLsb(&pieces);
-        attacks = (type == BISHOP) ? pos.getAttackSet(sq, (pos.occupiedBB[0] | pos.occupiedBB[1]) ^ pos.pieceBB[WQUEEN] ^ pos.pieceBB[BQUEEN])
-            : (type == ROOK) ? pos.getAttackSet(sq, (pos.occupiedBB[0] | pos.occupiedBB[1]) ^ pos.pieceBB[WQUEEN] ^ pos.pieceBB[BQUEEN] ^ pos.pieceBB[pc])
-            : pos.getAttackSet(sq, (pos.occupiedBB[0] | pos.occupiedBB[1]));
+        if (type != KNIGHT && use_avx2_attacks)
+            attacks = sliderAttacks[sq];
+        else
+            attacks = (type == BISHOP) ? pos.getAttackSet(sq, (pos.occupiedBB[0] | pos.occupiedBB[1]) ^ pos.pieceBB[WQUEEN] ^ pos.pieceBB[BQUEEN])
+                : (type == ROOK) ? pos.getAttackSet(sq, (pos.occupiedBB[0] | pos.occupiedBB[1]) ^ pos.pieceBB[WQUEEN] ^ pos.pieceBB[BQUEEN] ^ pos.pieceBB[pc])
+                : ATTACKS_FROM(pos, sq, (pos.occupiedBB[0] | pos.occupiedBB[1]));
         if ((pos.blockersForKing[side][0] | pos.blockersForKing[side][1]) & BITSET(sq))
             attacks &= RAY_MASKS[sq][pos.kingpos[side]];
 
@@ -659,7 +703,7 @@ template <Tracing T> template <Color side, PieceType type> Score Eval<T>::evalua
     return out;
 }
 
-template <Tracing T> template <Color side> Score Eval<T>::evaluate_threats() const
+template <Tracing T> template <Color side, int V> Score Eval<T>::evaluate_threats() const
 {
     Color opponent = ~side;
     Score out = S(0, 0);
@@ -683,7 +727,7 @@ template <Tracing T> template <Color side> Score Eval<T>::evaluate_threats() con
             #endif // TUNERTRACE
         }
 
-        attacked = (pos.pieceBB[make_piece(opponent, QUEEN)] | weak) & (attackedSquares[make_piece(side, ROOK)]);
+        attacked = (V & EVAL_NO_ROOKS) ? 0ULL : (pos.pieceBB[make_piece(opponent, QUEEN)] | weak) & (attackedSquares[make_piece(side, ROOK)]);
         while (attacked)
         {
             sq = popLsb(&attacked);
@@ -711,6 +755,13 @@ template <Tracing T> template <Color side> Score Eval<T>::evaluate_threats() con
         #endif // TUNERTRACE
     }
 
+    if (V & EVAL_PAWNLESS)
+    {
+        if (T)
+            trace_scores[THREAT][side] = out;
+        return out;
+    }
+
     U64 safe = ~attackedSquares[opponent] | attackedSquares[side];
     U64 safePawns = safe & pos.pieceBB[make_piece(side, PAWN)];
     attacked = PAWNATTACKS(side, safePawns) & nonPawns;
@@ -736,64 +787,59 @@ template <Tracing T> template <Color side> Score Eval<T>::evaluate_threats() con
     return out;
 }
 
-int imbalance(const Position& pos, Color side)
+int imbalance(const int* pieceCount, Color side)
 {
     // Quadratic material imbalance by Tord Romstad
     int bonus = 0;
     for (int pt1 = PAWN; pt1 < KING; ++pt1) {
-        if (!pos.pieceCount[make_piece(side, PieceType(pt1))]) {
+        if (!pieceCount[make_piece(side, PieceType(pt1))]) {
             continue;
         }
 
         for (int pt2 = PAWN; pt2 <= pt1; ++pt2) {
-            bonus += pos.pieceCount[make_piece(side, PieceType(pt1))] * (my_pieces[pt1 - 1][pt2 - 1] * pos.pieceCount[make_piece(side, PieceType(pt2))] +
-                opponent_pieces[pt1 - 1][pt2 - 1] * pos.pieceCount[make_piece(~side, PieceType(pt2))]);
+            bonus += pieceCount[make_piece(side, PieceType(pt1))] * (my_pieces[pt1 - 1][pt2 - 1] * pieceCount[make_piece(side, PieceType(pt2))] +
+                opponent_pieces[pt1 - 1][pt2 - 1] * pieceCount[make_piece(~side, PieceType(pt2))]);
             #if TUNERTRACE
-            Trace.my_pieces[side][pt1 - 1][pt2 - 1] += (pos.pieceCount[make_piece(side, PieceType(pt1))]*pos.pieceCount[make_piece(side, PieceType(pt2))]);
-            Trace.opponent_pieces[side][pt1 - 1][pt2 - 1] += (pos.pieceCount[make_piece(side, PieceType(pt1))]*pos.pieceCount[make_piece(~side, PieceType(pt2))]);
+            Trace.my_pieces[side][pt1 - 1][pt2 - 1] += (pieceCount[make_piece(side, PieceType(pt1))]*pieceCount[make_piece(side, PieceType(pt2))]);
+            Trace.opponent_pieces[side][pt1 - 1][pt2 - 1] += (pieceCount[make_piece(side, PieceType(pt1))]*pieceCount[make_piece(~side, PieceType(pt2))]);
             #endif // TUNERTRACE
         }
     }
     return bonus;
 }
 
-U64 materialKey(const Position& pos)
+U64 materialKey(const int* pieceCount)
 {
     U64 materialhash = 0ULL;
 
     for (int i = WPAWN; i <= BKING; i++)
-        for (int j = 0; j < pos.pieceCount[i]; j++)
+        for (int j = 0; j < pieceCount[i]; j++)
             materialhash ^= zb.pieceKeys[(j << 4) | i];
 
     return materialhash;
 }
 
-materialhashEntry* probeMaterial(const Position& pos)
-{
-    materialhashEntry* material = get_materialEntry(pos);
+/// Shared, read-only material table with one slot per material configuration up to materialMax,
+/// filled once at startup. Configurations beyond it (extra promoted pieces) use the per-thread
+/// overflow hash table instead.
+materialEntry materialTable[MATERIAL_ENTRIES];
 
-#ifndef __TUNE__
-    if (material->key == pos.materialhash)
-    {
-        return material;
-    }
-#endif
-
-    material->key = pos.materialhash;
-    material->phase = ((24 - (pos.pieceCount[WBISHOP] + pos.pieceCount[BBISHOP] + pos.pieceCount[WKNIGHT] + pos.pieceCount[BKNIGHT])
-        - 2 * (pos.pieceCount[WROOK] + pos.pieceCount[BROOK])
-        - 4 * (pos.pieceCount[WQUEEN] + pos.pieceCount[BQUEEN])) * 255 + 12) / 24;
+void compute_material(const int* pieceCount, materialEntry* material)
+{
+    material->phase = ((24 - (pieceCount[WBISHOP] + pieceCount[BBISHOP] + pieceCount[WKNIGHT] + pieceCount[BKNIGHT])
+        - 2 * (pieceCount[WROOK] + pieceCount[BROOK])
+        - 4 * (pieceCount[WQUEEN] + pieceCount[BQUEEN])) * 255 + 12) / 24;
 
-    int value = (imbalance(pos, WHITE) - imbalance(pos, BLACK)) / 16;
+    int value = (imbalance(pieceCount, WHITE) - imbalance(pieceCount, BLACK)) / 16;
 
     // Bishop pair
-    if (pos.pieceCount[WBISHOP] > 1) {
+    if (pieceCount[WBISHOP] > 1) {
         value += bishop_pair;
         #if TUNERTRACE
         Trace.bishop_pair[WHITE]++;
         #endif // TUNERTRACE
     }
-    if (pos.pieceCount[BBISHOP] > 1) {
+    if (pieceCount[BBISHOP] > 1) {
         value -= bishop_pair;
         #if TUNERTRACE
         Trace.bishop_pair[BLACK]++;
@@ -804,13 +850,13 @@ materialhashEntry* probeMaterial(const Position& pos)
 
     // Endgames
 
-    int white_minor = pos.pieceCount[WBISHOP] + pos.pieceCount[WKNIGHT];
-    int white_major = pos.pieceCount[WROOK] + pos.pieceCount[WQUEEN];
-    int black_minor = pos.pieceCount[BBISHOP] + pos.pieceCount[BKNIGHT];
-    int black_major = pos.pieceCount[BROOK] + pos.pieceCount[BQUEEN];
+    int white_minor = pieceCount[WBISHOP] + pieceCount[WKNIGHT];
+    int white_major = pieceCount[WROOK] + pieceCount[WQUEEN];
+    int black_minor = pieceCount[BBISHOP] + pieceCount[BKNIGHT];
+    int black_major = pieceCount[BROOK] + pieceCount[BQUEEN];
     int all_minor = white_minor + black_minor;
     int all_major = white_major + black_major;
-    bool no_pawns = pos.pieceCount[WPAWN] == 0 && pos.pieceCount[BPAWN] == 0;
+    bool no_pawns = pieceCount[WPAWN] == 0 && pieceCount[BPAWN] == 0;
 
     material->isDrawn = false;
 
@@ -820,30 +866,72 @@ materialhashEntry* probeMaterial(const Position& pos)
     else if (no_pawns && all_major == 0 && white_minor < 2 && black_minor < 2) {
         material->isDrawn = true;
     }
-    else if (no_pawns && all_major == 0 && all_minor == 2 && (pos.pieceCount[WKNIGHT] == 2 || pos.pieceCount[BKNIGHT] == 2)) {
+    else if (no_pawns && all_major == 0 && all_minor == 2 && (pieceCount[WKNIGHT] == 2 || pieceCount[BKNIGHT] == 2)) {
         material->isDrawn = true;
     }
 
-    material->hasSpecialEndgame = false;
-    material->evaluation = nullptr;
+    material->evaluation = 0;
+    material->scaling = 0;
+    material->strongSide = WHITE;
+
+    if (no_pawns)
+        material->variant = EVAL_PAWNLESS;
+    else if (all_major == 0)
+        material->variant = EVAL_MINORS;
+    else if (pieceCount[WQUEEN] + pieceCount[BQUEEN] == 0)
+        material->variant = EVAL_NO_QUEENS;
+    else
+        material->variant = EVAL_GENERIC;
+
+    /// Specialized evaluation and scale functions for known endgames
+    if (!material->isDrawn)
+        probe_endgame(pieceCount, material);
+}
+
+void init_material()
+{
+    int pieceCount[14] = {};
+    pieceCount[WKING] = pieceCount[BKING] = 1;
 
-    /// Special endgame for KBNvK
-    if (pos.materialhash == 0xa088eeb4f991b4ea || pos.materialhash == 0x52f8aa4b980286be)
+    for (int index = 0; index < MATERIAL_ENTRIES; index++)
     {
-        material->hasSpecialEndgame = true;
-        material->evaluation = &KBNvK;
+        compute_material(pieceCount, &materialTable[index]);
+
+        // Step the counts like an odometer, WPAWN being the lowest digit of material_index()
+        for (int pc = WPAWN; pc <= BQUEEN && ++pieceCount[pc] > materialMax[pc]; pc++)
+            pieceCount[pc] = 0;
     }
+}
 
-    return material;
+materialEntry* probeMaterial(const Position& pos)
+{
+#ifndef __TUNE__
+    int index = material_index(pos.pieceCount);
+    if (index >= 0)
+        return &materialTable[index];
+#endif
+
+    materialhashEntry* entry = &pos.my_thread->materialOverflow[pos.materialhash & MATERIAL_OVERFLOW_MASK];
+
+#ifndef __TUNE__
+    if (entry->key == pos.materialhash)
+    {
+        return &entry->material;
+    }
+#endif
+
+    entry->key = pos.materialhash;
+    compute_material(pos.pieceCount, &entry->material);
+    return &entry->material;
 }
 
 template <Tracing T> int Eval<T>::value()
 {
-    materialhashEntry* material = probeMaterial(pos);
+    const materialEntry* material = probeMaterial(pos);
 
-    if (material->hasSpecialEndgame)
+    if (material->evaluation)
     {
-        return material->evaluation(pos);
+        return endgameFunctions[material->evaluation](pos, Color(material->strongSide));
     }
 
     if (material->isDrawn)
@@ -855,6 +943,23 @@ template <Tracing T> int Eval<T>::value()
         return 1 - (pos.my_thread->nodes & 2);
     }
 
+    #ifndef __TUNE__
+    if (!T)
+    {
+        switch (material->variant)
+        {
+        case EVAL_NO_QUEENS: return evaluate_variant<EVAL_NO_QUEENS>(material);
+        case EVAL_MINORS:    return evaluate_variant<EVAL_MINORS>(material);
+        case EVAL_PAWNLESS:  return evaluate_variant<EVAL_PAWNLESS>(material);
+        }
+    }
+    #endif // __TUNE__
+
+    return evaluate_variant<EVAL_GENERIC>(material);
+}
+
+template <Tracing T> template <int V> int Eval<T>::evaluate_variant(const materialEntry* material)
+{
     pawntte = get_pawntte(pos);
     evaluate_pawns();
 
@@ -872,28 +977,39 @@ template <Tracing T> int Eval<T>::value()
 
     pre_eval();
 
+    if (use_avx2_attacks)
+        slider_attacks();
     out += evaluate_piece<WHITE, KNIGHT>() - evaluate_piece<BLACK, KNIGHT>() +
-        evaluate_piece<WHITE, BISHOP>() - evaluate_piece<BLACK, BISHOP>() +
-        evaluate_piece<WHITE, ROOK>() - evaluate_piece<BLACK, ROOK>() +
-        evaluate_piece<WHITE, QUEEN>() - evaluate_piece<BLACK, QUEEN>();
-
-    out += evaluate_passers<WHITE>() - evaluate_passers<BLACK>() +
-        mobility[WHITE] - mobility[BLACK] +
-        evaluate_threats<WHITE>() - evaluate_threats<BLACK>() +
-        king_safety<WHITE>() - king_safety<BLACK>(); // add more components maybe?
+        evaluate_piece<WHITE, BISHOP>() - evaluate_piece<BLACK, BISHOP>();
+    if (!(V & EVAL_NO_ROOKS))
+        out += evaluate_piece<WHITE, ROOK>() - evaluate_piece<BLACK, ROOK>();
+    if (!(V & EVAL_NO_QUEENS))
+        out += evaluate_piece<WHITE, QUEEN>() - evaluate_piece<BLACK, QUEEN>();
+
+    if (!(V & EVAL_PAWNLESS))
+        out += evaluate_passers<WHITE>() - evaluate_passers<BLACK>();
+
+    out += mobility[WHITE] - mobility[BLACK] +
+        evaluate_threats<WHITE, V>() - evaluate_threats<BLACK, V>() +
+        king_safety<WHITE, V>() - king_safety<BLACK, V>(); // add more components maybe?
 #ifndef __TUNE__
     return_flag :
 #endif
 
     int phase = material->phase;
+    // Scale functions only ever pull the strong side's advantage towards a draw
+    int scale = material->scaling && S2MSIGN(material->strongSide) * eg_value(out) > 0
+        ? endgameFunctions[material->scaling](pos, Color(material->strongSide)) : SCALE_NONE;
+    if (scale == SCALE_NONE)
+        scale = pos.scaleFactor();
 
     #if TUNERTRACE
     Trace.originalScore = safetyTrace.originalScore = out; // always positive for white
     safetyTrace.originalScore -= (safetyTrace.dangerScore[WHITE] - safetyTrace.dangerScore[BLACK]);
-    Trace.scale = safetyTrace.scale = pos.scaleFactor() / (double)SCALE_NORMAL;
+    Trace.scale = safetyTrace.scale = scale / (double)SCALE_NORMAL;
     #endif // TUNERTRACE
 
-    int v = ((mg_value(out) * (256 - phase) + eg_value(out) * phase * pos.scaleFactor() / SCALE_NORMAL) / 256);
+    int v = ((mg_value(out) * (256 - phase) + eg_value(out) * phase * scale / SCALE_NORMAL) / 256);
 
     if (T)
     {
@@ -904,7 +1020,7 @@ template <Tracing T> int Eval<T>::value()
         trace_scores[MATERIAL][0] = pos.psqt_score;
         trace_scores[IMBALANCE][0] = material->score;
         trace_scores[PHASE][0] = Score(phase);
-        trace_scores[SCALE][0] = Score(pos.scaleFactor());
+        trace_scores[SCALE][0] = Score(scale);
         trace_scores[TEMPO][0] = Score(tempo);
         trace_scores[TOTAL][0] = out;
     }
@@ -917,7 +1033,32 @@ template <Tracing T> int Eval<T>::value()
 //a wrapper function to look clean :P
 int evaluate(const Position& pos)
 {
-    return Eval<NO_TRACE>(pos).value();
+    #ifndef __TUNE__
+    SearchThread *t = pos.my_thread;
+    U64 *entry = &t->evalCache[pos.key & t->evalCacheMask];
+    U64 cached = *entry;
+    t->evalCacheProbes++;
+    if (!((cached ^ pos.key) >> 16) && cached)
+    {
+        t->evalCacheHits++;
+        return (int16_t)(cached & 0xFFFF);
+    }
+    #endif
+
+    int v;
+    if (use_nnue)
+    {
+        // Known endgames are exact, so they take precedence over the network as well
+        const materialEntry* material = probeMaterial(pos);
+        v = material->evaluation ? endgameFunctions[material->evaluation](pos, Color(material->strongSide)) : nnue_evaluate(pos);
+    }
+    else
+        v = Eval<NO_TRACE>(pos).value();
+
+    #ifndef __TUNE__
+    *entry = (pos.key & ~0xFFFFULL) | (uint16_t)(int16_t)v;
+    #endif
+    return v;
 }
 
 double to_cp(int v) { return double(v) / PAWN_EG; }
@@ -983,17 +1124,11 @@ string trace(const Position& pos) {
 
     ss << "\nTotal evaluation: " << to_cp(v) << " (white side)\n";
 
-    return ss.str();
-}
+    if (use_nnue)
+    {
+        int nn = nnue_evaluate(pos);
+        ss << "NNUE evaluation: " << to_cp(pos.activeSide == WHITE ? nn : -nn) << " (white side)\n";
+    }
 
-int KBNvK(const Position& pos)
-{
-    Color strongerSide = (pos.psqt_score > 0) ? WHITE : BLACK;
-    bool darkBishop = (pos.pieceBB[WBISHOP + strongerSide] & DarkSquares);
-    int sk = pos.kingpos[strongerSide] ^ (darkBishop ? 0 : 56);
-    int wk = pos.kingpos[~strongerSide] ^ (darkBishop ? 0 : 56);
-    int kingDistance = 7 - squareDistance[wk][sk];
-    int cornerDistance = abs(7 - RANK(wk) - FILE(wk));
-
-    return (S2MSIGN(pos.activeSide) * (WON_ENDGAME + 420 * cornerDistance + 20 * kingDistance));
+    return ss.str();
 }
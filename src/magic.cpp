@@ -82,6 +82,33 @@ U64 bishopAttacks_slow(U64 occ, int sq)
     return slidingAttacks_slow(occ, sq, DIAG_MASKS, flipVertical) | slidingAttacks_slow(occ, sq, ANTIDIAG_MASKS, flipVertical);
 }
 
+bool use_pext = false;
+
+#ifdef PEXT_ATTACKS
+#include <cpuid.h>
+#endif
+
+/// PEXT is microcoded on AMD before Zen 3 (family 0x19) and much slower than a multiply there
+bool cpu_has_fast_pext()
+{
+#ifdef PEXT_ATTACKS
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & bit_BMI2))
+        return false;
+
+    __get_cpuid(0, &eax, &ebx, &ecx, &edx);
+    bool amd = (ebx == signature_AMD_ebx);
+    __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+    unsigned family = (eax >> 8) & 0xf;
+    if (family == 0xf)
+        family += (eax >> 20) & 0xff;
+
+    return !amd || family >= 0x19;
+#else
+    return false;
+#endif
+}
+
 void init_magics(U64 attackTable[], SMagic magics[], U64 *masks, U64 (*func)(U64, int), const U64 *magicNumbers)
 {
     U64 n;
@@ -101,3 +128,103 @@ void init_magics(U64 attackTable[], SMagic magics[], U64 *masks, U64 (*func)(U64
         } while ( n );
     }
 }
+
+/// Same 2^bits slice per square as the magic tables, indexed by PEXT. Each entry is the attack set
+/// PEXT-ed down to the empty-board attacks, which bishopAttacks()/rookAttacks() PDEP back out.
+void init_pext(uint16_t attackTable[], SPext tables[], U64 *masks, U64 (*func)(U64, int))
+{
+#ifdef PEXT_ATTACKS
+    uint16_t *aptr = attackTable;
+    for (int i = 0; i < 64; i++)
+    {
+        SPext &p = tables[i];
+        U64 empty = func(0, i);
+        p.mask = masks[i];
+        p.aptr = aptr;
+        U64 n = 0;
+        do {
+            p.aptr[pext(n, p.mask)] = uint16_t(pext(func(n, i), empty));
+            n = (n - p.mask) & p.mask;
+        } while ( n );
+        aptr += 1ULL << POPCOUNT(p.mask);
+    }
+#else
+    (void)attackTable; (void)tables; (void)masks; (void)func;
+#endif
+}
+
+bool use_avx2_attacks = false;
+
+#ifdef SIMD_ATTACKS
+#include <immintrin.h>
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+/// Kogge-Stone occluded fill towards higher squares, four bitboards at a time.
+/// wrap clears the file the shift would wrap around onto.
+template <int S> AVX2_TARGET static inline __m256i fill_up(__m256i gen, __m256i pro, __m256i wrap)
+{
+    pro = _mm256_and_si256(pro, wrap);
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_slli_epi64(gen, S)));
+    pro = _mm256_and_si256(pro, _mm256_slli_epi64(pro, S));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_slli_epi64(gen, 2 * S)));
+    pro = _mm256_and_si256(pro, _mm256_slli_epi64(pro, 2 * S));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_slli_epi64(gen, 4 * S)));
+    return _mm256_and_si256(_mm256_slli_epi64(gen, S), wrap);
+}
+
+template <int S> AVX2_TARGET static inline __m256i fill_down(__m256i gen, __m256i pro, __m256i wrap)
+{
+    pro = _mm256_and_si256(pro, wrap);
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srli_epi64(gen, S)));
+    pro = _mm256_and_si256(pro, _mm256_srli_epi64(pro, S));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srli_epi64(gen, 2 * S)));
+    pro = _mm256_and_si256(pro, _mm256_srli_epi64(pro, 2 * S));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srli_epi64(gen, 4 * S)));
+    return _mm256_and_si256(_mm256_srli_epi64(gen, S), wrap);
+}
+
+/// Arrays are read and written in whole groups of four, so they must have room for n rounded up to a multiple of 4.
+AVX2_TARGET void slider_attacks_avx2(const int *squares, const U64 *occ, U64 *out, int n, bool diagonal, bool orthogonal)
+{
+    const __m256i notA = _mm256_set1_epi64x(~FileABB);
+    const __m256i notH = _mm256_set1_epi64x(~FileHBB);
+    const __m256i all = _mm256_set1_epi64x(-1);
+    const __m256i one = _mm256_set1_epi64x(1);
+    for (int i = 0; i < n; i += 4)
+    {
+        __m256i sq = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(squares + i)));
+        __m256i gen = _mm256_sllv_epi64(one, sq);
+        __m256i pro = _mm256_andnot_si256(_mm256_loadu_si256((const __m256i*)(occ + i)), all);
+        __m256i attacks = _mm256_setzero_si256();
+        if (diagonal)
+        {
+            attacks = _mm256_or_si256(attacks, fill_up<9>(gen, pro, notA));
+            attacks = _mm256_or_si256(attacks, fill_up<7>(gen, pro, notH));
+            attacks = _mm256_or_si256(attacks, fill_down<9>(gen, pro, notH));
+            attacks = _mm256_or_si256(attacks, fill_down<7>(gen, pro, notA));
+        }
+        if (orthogonal)
+        {
+            attacks = _mm256_or_si256(attacks, fill_up<8>(gen, pro, all));
+            attacks = _mm256_or_si256(attacks, fill_up<1>(gen, pro, notA));
+            attacks = _mm256_or_si256(attacks, fill_down<8>(gen, pro, all));
+            attacks = _mm256_or_si256(attacks, fill_down<1>(gen, pro, notH));
+        }
+        _mm256_storeu_si256((__m256i*)(out + i), attacks);
+    }
+}
+
+/// The kernel only runs when the CPU reports AVX2, so any x86-64 build can carry it. It is opt-in
+/// (-DAVX2_EVAL) because the magic lookups it replaces are still faster for a handful of sliders.
+void init_simd_attacks()
+{
+    #ifdef AVX2_EVAL
+    __builtin_cpu_init();
+    use_avx2_attacks = __builtin_cpu_supports("avx2");
+    #endif // AVX2_EVAL
+}
+#else
+void slider_attacks_avx2(const int*, const U64*, U64*, int, bool, bool) {}
+void init_simd_attacks() {}
+#endif // SIMD_ATTACKS
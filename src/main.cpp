@@ -18,12 +18,16 @@
 
 #include "Beef.h"
 
+int startupTime;
+
 int main(int argc, char **argv)
 {
+	int start = getRealTime();
 	Position::init();
 	//get_ready();
 	init_tt();
 	book.init(openingBookPath);
+	startupTime = getRealTime() - start;
 
 	if (argc > 1 && strstr(argv[1], "bench"))
     {
@@ -33,6 +37,7 @@ int main(int argc, char **argv)
 
 
     #ifdef __TUNE__
+    init_search_tables();
     tune();
     //localTune();
     #else
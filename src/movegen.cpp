@@ -26,12 +26,18 @@ template <PieceType Pt> SMove* generatePieceMoves(const Position &pos, SMove *mo
     while (fromSquares)
     {
         int from = popLsb(&fromSquares);
+        #ifdef ATTACKMAPS
+        (void)occ;
+        if (Pt != KING)
+            tobits = pos.attacksFrom[from] & to_squares;
+        #else
         if (Pt == KNIGHT)
             tobits = PseudoAttacks[KNIGHT][from] & to_squares;
         if(Pt == BISHOP || Pt == QUEEN)
             tobits |= bishopAttacks(occ, from) & to_squares;
         if (Pt == ROOK || Pt == QUEEN)
             tobits |= rookAttacks(occ, from) & to_squares;
+        #endif // ATTACKMAPS
         if (Pt == KING)
             tobits = PseudoAttacks[KING][from] & to_squares & ~pos.tabooSquares();
         while (tobits)
@@ -71,7 +77,7 @@ template <Color side, MoveType Mt> inline SMove* generatePawnMoves(const Positio
 
     if (Mt == QUIET_CHECK)
     {
-        U64 target = PAWN_ATTACKSFROM[side][pos.kingpos[opponent]];
+        U64 target = pos.checkSquares[PAWN];
         U64 b1 = shift<Up>(pawnsNotOn7)   & emptySquares & target;
         U64 b2 = shift<Up>(b1 & TRank3BB) & emptySquares & target;
         while (b1)
@@ -286,6 +292,27 @@ template <Color side, MoveType Mt> SMove* generatePinnedMoves(const Position &po
 	return movelist;
 }
 
+/// Squares from which each piece type of the side to move would attack the opponent king,
+/// and our pieces that uncover a slider on that king when they leave its line.
+/// Recomputed whenever the side to move or the board changes; givesCheck and
+/// generate_quiet_checks read these instead of recomputing slider attacks per move.
+void Position::updateCheckInfo()
+{
+    Color opponent = ~activeSide;
+    int sq = kingpos[opponent];
+    U64 occ = occupiedBB[0] | occupiedBB[1];
+
+    checkSquares[BLANKTYPE] = 0ULL;
+    checkSquares[PAWN] = PAWN_ATTACKSFROM[activeSide][sq];
+    checkSquares[KNIGHT] = PseudoAttacks[KNIGHT][sq];
+    checkSquares[BISHOP] = bishopAttacks(occ, sq);
+    checkSquares[ROOK] = rookAttacks(occ, sq);
+    checkSquares[QUEEN] = checkSquares[BISHOP] | checkSquares[ROOK];
+    checkSquares[KING] = 0ULL;
+
+    dcCandidates = (blockersForKing[opponent][0] | blockersForKing[opponent][1]) & occupiedBB[activeSide];
+}
+
 void Position::updateBlockers()
 {
     U64 bishops = pieceBB[WBISHOP] | pieceBB[BBISHOP] | pieceBB[WQUEEN] | pieceBB[BQUEEN];
@@ -407,7 +434,6 @@ template <Color side> SMove* generate_evasions(const Position &pos, SMove *movel
 
 template <Color side> SMove * generate_quiet_checks(const Position &pos, SMove *movelist)
 {
-    constexpr Color opponent = (side == WHITE) ? BLACK : WHITE;
     int myKing = pos.kingpos[side];
     int kingSquare = pos.kingpos[~side];
     U64 occ = (pos.occupiedBB[0] | pos.occupiedBB[1]);
@@ -419,10 +445,10 @@ template <Color side> SMove * generate_quiet_checks(const Position &pos, SMove *
     U64 notPinned = ~(diagPinned | straightPinned);
     U64 emptySquares = ~occ;
 
-    U64 knightSquares = PseudoAttacks[KNIGHT][kingSquare] & emptySquares;
-    U64 bishopSquares = bishopAttacks(occ, kingSquare) & emptySquares;
-    U64 rookSquares = rookAttacks(occ, kingSquare) & emptySquares;
-    U64 queenSquares = bishopSquares | rookSquares;
+    U64 knightSquares = pos.checkSquares[KNIGHT] & emptySquares;
+    U64 bishopSquares = pos.checkSquares[BISHOP] & emptySquares;
+    U64 rookSquares = pos.checkSquares[ROOK] & emptySquares;
+    U64 queenSquares = pos.checkSquares[QUEEN] & emptySquares;
 
     ///Quiet checks from non-pinned pieces
 
@@ -467,7 +493,7 @@ template <Color side> SMove * generate_quiet_checks(const Position &pos, SMove *
 
    ///discovered checks
 
-   U64 fossils = (pos.blockersForKing[opponent][0] | pos.blockersForKing[opponent][1]) & myPieces;
+   U64 fossils = pos.dcCandidates;
    U64 nonpinnedFossils = fossils & notPinned;
    U64 pinnedFossils = fossils ^ nonpinnedFossils;
 
@@ -576,6 +602,8 @@ MoveGen::MoveGen(Position *p, SearchType type, Move hshm, int t, int d)
     pos = p;
     depth = d;
     threshold = t;
+    picked = nullptr;
+    moveList = curr = endMoves = endBadCaptures = p->my_thread->moveTop;
 
     if (p->checkBB)
     {
@@ -595,6 +623,11 @@ MoveGen::MoveGen(Position *p, SearchType type, Move hshm, int t, int d)
             state = type == QUIESCENCE_SEARCH ? QUIESCENCE_HASHMOVE : PROBCUT_HASHMOVE;
         }
 
+        #ifdef TTSTATS
+        if (hshm != MOVE_NONE && !(pos->isPseudoLegal(hshm) && pos->isLegal(hshm)))
+            ttstats.badHashMoves++;
+        #endif // TTSTATS
+
         if (hashmove == MOVE_NONE)
         {
             state++;
@@ -605,6 +638,18 @@ MoveGen::MoveGen(Position *p, SearchType type, Move hshm, int t, int d)
     counterMove = p->my_thread->counterMoveTable[p->mailbox[prev_to]][prev_to];
 }
 
+template <MoveType Mt> void MoveGen::generate()
+{
+    endMoves = generate_all<Mt>(*pos, curr);
+    pos->my_thread->moveTop = endMoves;
+}
+
+constexpr int SEE_TIER = 1 << 16;
+constexpr int QUIET_SORT_LIMIT = 2000; // per ply of depth; quiets below -limit * depth are only sorted on demand
+constexpr int QUIET_THREAT_MINOR = 12288;
+constexpr int QUIET_THREAT_ROOK = 16384;
+constexpr int QUIET_THREAT_QUEEN = 24576;
+
 inline int quiet_score(Position *pos, searchInfo *info, Move m)
 {
     int from = from_sq(m);
@@ -622,17 +667,57 @@ inline int mvvlva_score(Position *pos, Move m)
     return mvvlva[pos->mailbox[to_sq(m)]][pos->mailbox[from_sq(m)]];
 }
 
+void MoveGen::compute_threats()
+{
+    Color them = ~pos->activeSide;
+    U64 occ = pos->occupiedBB[WHITE] | pos->occupiedBB[BLACK];
+    U64 b;
+
+    threatByPawn = PAWNATTACKS(them, pos->pieceBB[make_piece(them, PAWN)]);
+
+    threatByMinor = threatByPawn;
+    b = pos->pieceBB[make_piece(them, KNIGHT)];
+    while (b)
+        threatByMinor |= PseudoAttacks[KNIGHT][popLsb(&b)];
+    b = pos->pieceBB[make_piece(them, BISHOP)];
+    while (b)
+        threatByMinor |= bishopAttacks(occ, popLsb(&b));
+
+    threatByRook = threatByMinor;
+    b = pos->pieceBB[make_piece(them, ROOK)];
+    while (b)
+        threatByRook |= rookAttacks(occ, popLsb(&b));
+}
+
+// Reward moving a piece out of the reach of a lesser attacker to a square that is out of it too.
+// Penalizing quiets onto such squares as well cost nodes to depth in testing, so that half is left out.
+inline int threat_score(PieceType pt, int from, int to, U64 threatByPawn, U64 threatByMinor, U64 threatByRook)
+{
+    static const int bonus[7] = { 0, 0, QUIET_THREAT_MINOR, QUIET_THREAT_MINOR, QUIET_THREAT_ROOK, QUIET_THREAT_QUEEN, 0 };
+    U64 threatened = pt == QUEEN ? threatByRook
+                   : pt == ROOK ? threatByMinor
+                   : pt != KING && pt != PAWN ? threatByPawn : 0;
+
+    return (threatened & BITSET(from)) && !(threatened & BITSET(to)) ? bonus[pt] : 0;
+}
+
 void MoveGen::scoreMoves(searchInfo *info, ScoreType type)
 {
+    if (type == SCORE_QUIET)
+        compute_threats();
+
     for (auto &m : *this)
     {
         if (type == SCORE_CAPTURE)
         {
-            m.value = mvvlva_score(pos, m.code);
+            ///Winning captures, then even ones, by MVV/LVA; losing captures last, least losing first
+            m.see = pos->see_value(m.code);
+            m.value = m.see < 0 ? m.see - SEE_TIER : mvvlva_score(pos, m.code) + (m.see > 0 ? SEE_TIER : 0);
         }
         else if (type == SCORE_QUIET)
         {
-            m.value = quiet_score(pos, info, m.code);
+            m.value = quiet_score(pos, info, m.code)
+                + threat_score(PieceType(pos->mailbox[from_sq(m.code)] >> 1), from_sq(m.code), to_sq(m.code), threatByPawn, threatByMinor, threatByRook);
         }
         else //evasion
         {
@@ -651,20 +736,39 @@ template <PickType type> Move MoveGen::select_move()
     if (type == BEST)
         swap(*curr, *max_element(curr, endMoves));
 
+    picked = curr;
     return *curr++;
 }
 
-void insertion_sort(SMove *head, SMove *tail)
+bool MoveGen::see(Move m, int bound) const
 {
-    for (SMove *i = head + 1; i < tail; i++)
+    if (picked && picked->code == m && picked->see != SEE_UNKNOWN)
+        return picked->see >= bound;
+
+    return pos->see(m, bound);
+}
+
+/// Insertion sort of only the moves scoring at least limit, which end up best first at the front.
+/// The rest stay unsorted behind them and are picked with select_move<BEST> if the node gets that far.
+/// Returns the end of the sorted run.
+SMove* partial_insertion_sort(SMove *head, SMove *tail, int limit)
+{
+    SMove *sortedEnd = head;
+    for (SMove *i = head; i < tail; i++)
     {
+        if (i->value < limit)
+            continue;
+
         SMove tmp = *i, *j;
-        for (j = i; j != head && *(j-1) < tmp; --j)
+        *i = *sortedEnd;
+        for (j = sortedEnd; j != head && *(j-1) < tmp; --j)
         {
             *j = *(j - 1);
         }
         *j = tmp;
+        sortedEnd++;
     }
+    return sortedEnd;
 }
 
 Move MoveGen::next_move(searchInfo *info, bool skipQuiets)
@@ -677,7 +781,7 @@ Move MoveGen::next_move(searchInfo *info, bool skipQuiets)
             return hashmove;
         case TACTICAL_INIT:
             curr = endBadCaptures = moveList;
-            endMoves = generate_all<TACTICAL>(*pos, curr);
+            generate<TACTICAL>();
             scoreMoves(info, SCORE_CAPTURE);
             ++state;
             /* fallthrough */
@@ -688,10 +792,10 @@ Move MoveGen::next_move(searchInfo *info, bool skipQuiets)
                 if (m == hashmove)
                     continue;
 
-                if (pos->see(m, 0))
+                if (picked->see >= 0)
                     return m;
 
-                *endBadCaptures++ = m;
+                *endBadCaptures++ = *picked;
             }
             ++state;
             m = info->killers[0];
@@ -730,9 +834,9 @@ Move MoveGen::next_move(searchInfo *info, bool skipQuiets)
             if (!skipQuiets)
             {
                 curr = endBadCaptures;
-                endMoves = generate_all<QUIET>(*pos, curr);
+                generate<QUIET>();
                 scoreMoves(info, SCORE_QUIET);
-                insertion_sort(curr, endMoves);
+                endSorted = partial_insertion_sort(curr, endMoves, -QUIET_SORT_LIMIT * depth);
             }
             ++state;
             /* fallthrough */
@@ -741,7 +845,7 @@ Move MoveGen::next_move(searchInfo *info, bool skipQuiets)
             {
                 while (curr < endMoves)
                 {
-                    m = select_move<NEXT>();
+                    m = curr < endSorted ? select_move<NEXT>() : select_move<BEST>();
 
                     if (m != hashmove &&
                         m != info->killers[0] &&
@@ -768,7 +872,7 @@ Move MoveGen::next_move(searchInfo *info, bool skipQuiets)
 
         case EVASIONS_INIT:
             curr = moveList;
-            endMoves = generate_all<EVASION>(*pos, curr);
+            generate<EVASION>();
             scoreMoves(info, SCORE_EVASION);
             ++state;
             /* fallthrough */
@@ -787,7 +891,7 @@ Move MoveGen::next_move(searchInfo *info, bool skipQuiets)
         case QUIESCENCE_CAPTURES_INIT:
             curr = endBadCaptures = moveList;
 
-            endMoves = generate_all<TACTICAL>(*pos, curr);
+            generate<TACTICAL>();
             scoreMoves(info, SCORE_CAPTURE);
             ++state;
             /* fallthrough */
@@ -807,7 +911,7 @@ Move MoveGen::next_move(searchInfo *info, bool skipQuiets)
             /* fallthrough */
         case QUIESCENCE_CHECKS_INIT:
             curr = moveList;
-            endMoves = generate_all <QUIET_CHECK> (*pos, curr);
+            generate<QUIET_CHECK>();
             ++state;
             /* fallthrough */
         case QUIESCENCE_CHECKS:
@@ -826,7 +930,7 @@ Move MoveGen::next_move(searchInfo *info, bool skipQuiets)
 
         case PROBCUT_CAPTURES_INIT:
             curr = endBadCaptures = moveList;
-            endMoves = generate_all<TACTICAL>(*pos, curr);
+            generate<TACTICAL>();
             scoreMoves(info, SCORE_CAPTURE);
             ++state;
             /* fallthrough */
@@ -835,7 +939,7 @@ Move MoveGen::next_move(searchInfo *info, bool skipQuiets)
             while (curr < endMoves)
             {
                 m = select_move<BEST>();
-                if (m != hashmove && pos->see(m, threshold))
+                if (m != hashmove && picked->see >= threshold)
                     return m;
             }
             break;
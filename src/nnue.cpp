@@ -0,0 +1,328 @@
+/*
+  Beef is a UCI-compliant chess engine.
+  Copyright (C) 2020 Jonathan Tseng.
+
+  Beef is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Beef is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Beef.h"
+
+// The kernels are compiled once per instruction set and chosen when the engine starts, so one
+// x86-64 binary uses AVX2 or AVX-512 where available without having been built for it.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define NNUE_DISPATCH
+#endif
+
+#if defined(NNUE_DISPATCH) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+/*
+    EvalFile layout, all little endian:
+        char     magic[8]          "BEEFNNUE"
+        uint32_t version           1
+        uint32_t dims[4]           NNUE_INPUTS, NNUE_HIDDEN, NNUE_L2, NNUE_L3
+        int16_t  ftBiases[NNUE_HIDDEN]
+        int16_t  ftWeights[NNUE_INPUTS][NNUE_HIDDEN]
+        int32_t  l2Biases[NNUE_L2]
+        int8_t   l2Weights[NNUE_L2][2 * NNUE_HIDDEN]
+        int32_t  l3Biases[NNUE_L3]
+        int8_t   l3Weights[NNUE_L3][NNUE_L2]
+        int32_t  outBias
+        int8_t   outWeights[NNUE_L3]
+
+    The side to move's accumulator comes first in the hidden layer. Hidden values are clipped
+    to [0, 127], the two inner layers shift by NNUE_SHIFT and clip to [0, 127], and the output
+    is divided by NNUE_OUTPUT_SCALE to give a score in internal units for the side to move.
+*/
+
+const int NNUE_SHIFT = 6;
+const int NNUE_OUTPUT_SCALE = 16;
+const int NNUE_VERSION = 1;
+
+struct NNUENet
+{
+    int16_t ftBiases[NNUE_HIDDEN];
+    int16_t *ftWeights;
+    int32_t l2Biases[NNUE_L2];
+    int8_t l2Weights[NNUE_L2 * 2 * NNUE_HIDDEN];
+    int32_t l3Biases[NNUE_L3];
+    int8_t l3Weights[NNUE_L3 * NNUE_L2];
+    int32_t outBias;
+    int8_t outWeights[NNUE_L3];
+};
+
+NNUENet net;
+bool use_nnue = false;
+string evalFilePath;
+
+const int kingBuckets[32] = {
+     0,  1,  2,  3,
+     4,  5,  6,  7,
+     8,  9, 10, 11,
+     8,  9, 10, 11,
+    12, 13, 14, 15,
+    12, 13, 14, 15,
+    12, 13, 14, 15,
+    12, 13, 14, 15,
+};
+
+inline int relative_king(Color c, int ksq)
+{
+    return ksq ^ (c ? 56 : 0);
+}
+
+inline int king_mirror(Color c, int ksq)
+{
+    return FILE(relative_king(c, ksq)) >= 4 ? 7 : 0;
+}
+
+///bucket and mirroring together decide which features a side sees
+inline int king_index(Color c, int ksq)
+{
+    int rel = relative_king(c, ksq);
+    int mirror = king_mirror(c, ksq);
+    int folded = RANK(rel) * 4 + FILE(rel ^ mirror);
+    return (kingBuckets[folded] << 1) | (mirror != 0);
+}
+
+inline int feature_index(Color c, int ksq, PieceCode pc, int sq)
+{
+    if (pc == make_piece(c, KING))
+        return -1;
+
+    int pt = pc >> 1;
+    int piece = (pt == KING) ? 10 : (pt - PAWN) + (Color(pc & 1) == c ? 0 : 5);
+    int orient = (c ? 56 : 0) ^ king_mirror(c, ksq);
+    return (king_index(c, ksq) >> 1) * NNUE_PIECES * 64 + piece * 64 + (sq ^ orient);
+}
+
+inline int clip(int x)
+{
+    return std::min(std::max(x, 0), 127);
+}
+
+#ifdef NNUE_DISPATCH
+namespace nnue_sse2 {
+#define NNUE_ARCH 1
+#define NNUE_TARGET
+#include "nnue_kernels.h"
+#undef NNUE_ARCH
+#undef NNUE_TARGET
+}
+
+namespace nnue_ssse3 {
+#define NNUE_ARCH 2
+#define NNUE_TARGET __attribute__((target("ssse3")))
+#include "nnue_kernels.h"
+#undef NNUE_ARCH
+#undef NNUE_TARGET
+}
+
+namespace nnue_avx2 {
+#define NNUE_ARCH 3
+#define NNUE_TARGET __attribute__((target("avx2")))
+#include "nnue_kernels.h"
+#undef NNUE_ARCH
+#undef NNUE_TARGET
+}
+
+namespace nnue_avx512 {
+#define NNUE_ARCH 4
+#define NNUE_TARGET __attribute__((target("avx512bw")))
+#include "nnue_kernels.h"
+#undef NNUE_ARCH
+#undef NNUE_TARGET
+}
+#else
+///other compilers get the one copy their flags allow
+namespace nnue_native {
+#if defined(__AVX512BW__)
+#define NNUE_ARCH 4
+#elif defined(__AVX2__)
+#define NNUE_ARCH 3
+#elif defined(__SSSE3__)
+#define NNUE_ARCH 2
+#elif defined(__SSE2__) || defined(_M_X64)
+#define NNUE_ARCH 1
+#else
+#define NNUE_ARCH 0
+#endif
+#define NNUE_TARGET
+#include "nnue_kernels.h"
+#undef NNUE_ARCH
+#undef NNUE_TARGET
+}
+#endif // NNUE_DISPATCH
+
+struct NNUEKernels
+{
+    const char *name;
+    void (*refresh)(const Position& pos, Color c, int16_t *acc);
+    void (*update)(const Position& pos, Color c, const NNUEAccumulator *parent, NNUEAccumulator *acc);
+    int (*output)(const int16_t *us, const int16_t *them);
+};
+
+#define NNUE_KERNELS(ns, name) { name, &ns::refresh_accumulator, &ns::update_accumulator, &ns::nnue_output }
+
+#ifdef NNUE_DISPATCH
+NNUEKernels kernels = NNUE_KERNELS(nnue_sse2, "SSE2");
+#else
+NNUEKernels kernels = NNUE_KERNELS(nnue_native, "native");
+#endif
+
+///pick the widest kernels the CPU runs, x86-64 always has SSE2
+void init_nnue()
+{
+#ifdef NNUE_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw"))
+        kernels = NNUE_KERNELS(nnue_avx512, "AVX-512");
+    else if (__builtin_cpu_supports("avx2"))
+        kernels = NNUE_KERNELS(nnue_avx2, "AVX2");
+    else if (__builtin_cpu_supports("ssse3"))
+        kernels = NNUE_KERNELS(nnue_ssse3, "SSSE3");
+#endif
+}
+
+void compute_accumulator(const Position& pos, NNUEAccumulator *stack, int idx, Color c)
+{
+    if (idx > 0 && stack[idx].computed[c])
+        return;
+
+    ///walk back to the nearest usable ancestor; the root slot is never trusted since
+    ///positions can be set up without going through do_move
+    int j = idx;
+    while (j > 0 && !stack[j].computed[c] && !stack[j].refresh[c])
+        j--;
+
+    if (j == 0 || stack[j].refresh[c])
+    {
+        kernels.refresh(pos, c, stack[idx].values[c]);
+        stack[idx].computed[c] = true;
+        return;
+    }
+
+    for (int k = j + 1; k <= idx; k++)
+        kernels.update(pos, c, &stack[k - 1], &stack[k]);
+}
+
+NNUEAccumulator* nnue_push(const Position& pos)
+{
+    if (!use_nnue || !pos.my_thread)
+        return nullptr;
+
+    int idx = pos.historyIndex - pos.my_thread->rootheight;
+    if (idx <= 0 || idx >= NNUE_STACK)
+        return nullptr;
+
+    NNUEAccumulator *acc = &pos.my_thread->nnueStack[idx];
+    acc->computed[WHITE] = acc->computed[BLACK] = false;
+    acc->refresh[WHITE] = acc->refresh[BLACK] = false;
+    acc->dirtyCount = 0;
+    return acc;
+}
+
+void nnue_dirty(NNUEAccumulator *acc, PieceCode pc, int from, int to)
+{
+    int i = acc->dirtyCount++;
+    acc->dirtyPiece[i] = pc;
+    acc->dirtyFrom[i] = (uint8_t)from;
+    acc->dirtyTo[i] = (uint8_t)to;
+
+    if ((pc >> 1) == KING)
+    {
+        Color c = Color(pc & 1);
+        acc->refresh[c] |= king_index(c, from) != king_index(c, to);
+    }
+}
+
+int nnue_evaluate(const Position& pos)
+{
+    Color us = pos.activeSide;
+    SearchThread *t = pos.my_thread;
+    int idx = t ? pos.historyIndex - t->rootheight : -1;
+
+    if (idx < 0 || idx >= NNUE_STACK)
+    {
+        ///outside of a search, build both sides from scratch
+        int16_t acc[2][NNUE_HIDDEN];
+        kernels.refresh(pos, WHITE, acc[WHITE]);
+        kernels.refresh(pos, BLACK, acc[BLACK]);
+        return kernels.output(acc[us], acc[~us]);
+    }
+
+    compute_accumulator(pos, t->nnueStack, idx, WHITE);
+    compute_accumulator(pos, t->nnueStack, idx, BLACK);
+    return kernels.output(t->nnueStack[idx].values[us], t->nnueStack[idx].values[~us]);
+}
+
+template <typename T>
+bool read_array(ifstream& in, T *dst, size_t count)
+{
+    return (bool)in.read((char *)dst, sizeof(T) * count);
+}
+
+void nnue_unload()
+{
+    use_nnue = false;
+    delete[] net.ftWeights;
+    net.ftWeights = nullptr;
+    evalFilePath.clear();
+}
+
+bool nnue_load(string path)
+{
+    nnue_unload();
+
+    ifstream in(path, ios::binary);
+    if (!in)
+    {
+        cout << "info string Could not open EvalFile " << path << endl;
+        return false;
+    }
+
+    char magic[8];
+    uint32_t version, dims[4];
+    if (!read_array(in, magic, 8) || memcmp(magic, "BEEFNNUE", 8)
+        || !read_array(in, &version, 1) || version != NNUE_VERSION
+        || !read_array(in, dims, 4)
+        || dims[0] != NNUE_INPUTS || dims[1] != NNUE_HIDDEN || dims[2] != NNUE_L2 || dims[3] != NNUE_L3)
+    {
+        cout << "info string EvalFile " << path << " is not a compatible network" << endl;
+        return false;
+    }
+
+    net.ftWeights = new int16_t[(size_t)NNUE_INPUTS * NNUE_HIDDEN];
+    bool ok = read_array(in, net.ftBiases, NNUE_HIDDEN)
+           && read_array(in, net.ftWeights, (size_t)NNUE_INPUTS * NNUE_HIDDEN)
+           && read_array(in, net.l2Biases, NNUE_L2)
+           && read_array(in, net.l2Weights, NNUE_L2 * 2 * NNUE_HIDDEN)
+           && read_array(in, net.l3Biases, NNUE_L3)
+           && read_array(in, net.l3Weights, NNUE_L3 * NNUE_L2)
+           && read_array(in, &net.outBias, 1)
+           && read_array(in, net.outWeights, NNUE_L3);
+
+    if (!ok || in.peek() != EOF)
+    {
+        cout << "info string EvalFile " << path << " has the wrong size" << endl;
+        nnue_unload();
+        return false;
+    }
+
+    use_nnue = true;
+    evalFilePath = path;
+    cout << "info string Loaded EvalFile " << path << " (" << kernels.name << ")" << endl;
+    return true;
+}
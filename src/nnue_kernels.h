@@ -0,0 +1,214 @@
+/*
+  Beef is a UCI-compliant chess engine.
+  Copyright (C) 2020 Jonathan Tseng.
+
+  Beef is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Beef is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+    The NNUE inner loops. nnue.cpp includes this file once per instruction set, inside its own
+    namespace, with NNUE_ARCH and NNUE_TARGET set for that copy:
+
+        NNUE_ARCH   0 scalar, 1 SSE2, 2 SSSE3, 3 AVX2, 4 AVX-512BW
+        NNUE_TARGET the function attribute that lets the compiler emit those instructions
+
+    so there is deliberately no include guard.
+*/
+
+NNUE_TARGET inline void add_feature(int16_t *acc, int feature)
+{
+    const int16_t *w = &net.ftWeights[feature * NNUE_HIDDEN];
+    #if NNUE_ARCH >= 4
+    for (int i = 0; i < NNUE_HIDDEN; i += 32)
+    {
+        __m512i a = _mm512_loadu_si512((const void *)(acc + i));
+        __m512i b = _mm512_loadu_si512((const void *)(w + i));
+        _mm512_storeu_si512((void *)(acc + i), _mm512_add_epi16(a, b));
+    }
+    #elif NNUE_ARCH >= 3
+    for (int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(acc + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(w + i));
+        _mm256_storeu_si256((__m256i *)(acc + i), _mm256_add_epi16(a, b));
+    }
+    #else
+    for (int i = 0; i < NNUE_HIDDEN; i++)
+        acc[i] += w[i];
+    #endif
+}
+
+NNUE_TARGET inline void sub_feature(int16_t *acc, int feature)
+{
+    const int16_t *w = &net.ftWeights[feature * NNUE_HIDDEN];
+    #if NNUE_ARCH >= 4
+    for (int i = 0; i < NNUE_HIDDEN; i += 32)
+    {
+        __m512i a = _mm512_loadu_si512((const void *)(acc + i));
+        __m512i b = _mm512_loadu_si512((const void *)(w + i));
+        _mm512_storeu_si512((void *)(acc + i), _mm512_sub_epi16(a, b));
+    }
+    #elif NNUE_ARCH >= 3
+    for (int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(acc + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(w + i));
+        _mm256_storeu_si256((__m256i *)(acc + i), _mm256_sub_epi16(a, b));
+    }
+    #else
+    for (int i = 0; i < NNUE_HIDDEN; i++)
+        acc[i] -= w[i];
+    #endif
+}
+
+NNUE_TARGET void refresh_accumulator(const Position& pos, Color c, int16_t *acc)
+{
+    memcpy(acc, net.ftBiases, sizeof(net.ftBiases));
+    int ksq = pos.kingpos[c];
+    U64 pieces = pos.occupiedBB[WHITE] | pos.occupiedBB[BLACK];
+    while (pieces)
+    {
+        int sq = popLsb(&pieces);
+        int feature = feature_index(c, ksq, pos.mailbox[sq], sq);
+        if (feature >= 0)
+            add_feature(acc, feature);
+    }
+}
+
+///apply the pieces recorded by do_move on top of the parent's accumulator
+NNUE_TARGET void update_accumulator(const Position& pos, Color c, const NNUEAccumulator *parent, NNUEAccumulator *acc)
+{
+    memcpy(acc->values[c], parent->values[c], sizeof(acc->values[c]));
+    int ksq = pos.kingpos[c];
+    for (int i = 0; i < acc->dirtyCount; i++)
+    {
+        PieceCode pc = acc->dirtyPiece[i];
+        if (acc->dirtyFrom[i] != 64)
+        {
+            int feature = feature_index(c, ksq, pc, acc->dirtyFrom[i]);
+            if (feature >= 0)
+                sub_feature(acc->values[c], feature);
+        }
+        if (acc->dirtyTo[i] != 64)
+        {
+            int feature = feature_index(c, ksq, pc, acc->dirtyTo[i]);
+            if (feature >= 0)
+                add_feature(acc->values[c], feature);
+        }
+    }
+    acc->computed[c] = true;
+}
+
+///sum(w[i] * in[i]) for unsigned inputs in [0, 127] and signed weights
+template <int In>
+NNUE_TARGET inline int32_t dot(const uint8_t *in, const int8_t *w)
+{
+    #if NNUE_ARCH >= 4
+    if (In % 64 == 0)
+    {
+        __m512i vsum = _mm512_setzero_si512();
+        const __m512i ones = _mm512_set1_epi16(1);
+        for (int i = 0; i < In; i += 64)
+        {
+            __m512i x = _mm512_loadu_si512((const void *)(in + i));
+            __m512i y = _mm512_loadu_si512((const void *)(w + i));
+            vsum = _mm512_add_epi32(vsum, _mm512_madd_epi16(_mm512_maddubs_epi16(x, y), ones));
+        }
+        ///the masked extracts take an explicit source, the plain ones trip -Wuninitialized in GCC 12 headers
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i v = _mm256_add_epi32(_mm512_mask_extracti64x4_epi64(zero, 0xF, vsum, 0),
+                                     _mm512_mask_extracti64x4_epi64(zero, 0xF, vsum, 1));
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+        return _mm_cvtsi128_si32(s);
+    }
+    #endif
+    #if NNUE_ARCH >= 3
+    __m256i vsum = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int i = 0; i < In; i += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(in + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(w + i));
+        vsum = _mm256_add_epi32(vsum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, y), ones));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(vsum), _mm256_extracti128_si256(vsum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    return _mm_cvtsi128_si32(s);
+    #elif NNUE_ARCH == 2
+    __m128i vsum = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    for (int i = 0; i < In; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(w + i));
+        vsum = _mm_add_epi32(vsum, _mm_madd_epi16(_mm_maddubs_epi16(x, y), ones));
+    }
+    vsum = _mm_add_epi32(vsum, _mm_shuffle_epi32(vsum, 0x4E));
+    vsum = _mm_add_epi32(vsum, _mm_shuffle_epi32(vsum, 0xB1));
+    return _mm_cvtsi128_si32(vsum);
+    #elif NNUE_ARCH == 1
+    ///no maddubs, widen both sides to 16 bits first
+    __m128i vsum = _mm_setzero_si128();
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < In; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(w + i));
+        __m128i sign = _mm_cmpgt_epi8(zero, y);
+        vsum = _mm_add_epi32(vsum, _mm_madd_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(y, sign)));
+        vsum = _mm_add_epi32(vsum, _mm_madd_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(y, sign)));
+    }
+    vsum = _mm_add_epi32(vsum, _mm_shuffle_epi32(vsum, 0x4E));
+    vsum = _mm_add_epi32(vsum, _mm_shuffle_epi32(vsum, 0xB1));
+    return _mm_cvtsi128_si32(vsum);
+    #else
+    int32_t sum = 0;
+    for (int i = 0; i < In; i++)
+        sum += w[i] * in[i];
+    return sum;
+    #endif
+}
+
+///out[o] = clip((biases[o] + sum(weights[o][i] * in[i])) >> NNUE_SHIFT), inputs are in [0, 127]
+template <int In, int Out>
+NNUE_TARGET void affine_relu(const uint8_t *in, const int8_t *weights, const int32_t *biases, uint8_t *out)
+{
+    for (int o = 0; o < Out; o++)
+        out[o] = (uint8_t)clip((biases[o] + dot<In>(in, &weights[o * In])) >> NNUE_SHIFT);
+}
+
+NNUE_TARGET int nnue_output(const int16_t *us, const int16_t *them)
+{
+    uint8_t hidden[2 * NNUE_HIDDEN];
+    uint8_t l2[NNUE_L2];
+    uint8_t l3[NNUE_L3];
+
+    for (int i = 0; i < NNUE_HIDDEN; i++)
+    {
+        hidden[i] = (uint8_t)clip(us[i]);
+        hidden[NNUE_HIDDEN + i] = (uint8_t)clip(them[i]);
+    }
+
+    affine_relu<2 * NNUE_HIDDEN, NNUE_L2>(hidden, net.l2Weights, net.l2Biases, l2);
+    affine_relu<NNUE_L2, NNUE_L3>(l2, net.l3Weights, net.l3Biases, l3);
+
+    int32_t out = net.outBias;
+    for (int i = 0; i < NNUE_L3; i++)
+        out += net.outWeights[i] * l3[i];
+
+    return out / NNUE_OUTPUT_SCALE;
+}
@@ -139,8 +139,12 @@ void Position::readFEN(const char* fen)
 
     historyIndex = 0;
     capturedPiece = BLANK;
+    #ifdef ATTACKMAPS
+    update_attacks(~0ULL);
+    #endif // ATTACKMAPS
     checkBB = attackersTo(kingpos[activeSide], activeSide ^ SIDESWITCH);
     updateBlockers();
+    updateCheckInfo();
 }
 
 ostream& operator<<(ostream& os, const Position& pos) {
@@ -164,12 +168,16 @@ ostream& operator<<(ostream& os, const Position& pos) {
 
 bool Position::isAttacked(int sq, int side) const //isAttacked by side
 {
+    #ifdef ATTACKMAPS
+    return sideAttacks[side] & BITSET(sq);
+    #else
     U64 occ = occupiedBB[0] | occupiedBB[1];
     return PAWN_ATTACKSFROM[side][sq] & pieceBB[WPAWN | side]
         || PseudoAttacks[KNIGHT][sq] & pieceBB[WKNIGHT | side]
         || PseudoAttacks[KING][sq] & pieceBB[WKING | side]
         || bishopAttacks(occ, sq) & (pieceBB[WBISHOP | side] | pieceBB[WQUEEN | side])
         || rookAttacks(occ, sq) & (pieceBB[WROOK | side] | pieceBB[WQUEEN | side]);
+    #endif // ATTACKMAPS
 }
 
 U64 Position::attackersTo(int sq, int side, bool free) const // attackers from side
@@ -223,6 +231,16 @@ U64 Position::tabooSquares() const //gets all squares attacked by opponent (incl
     U64 occ = (occupiedBB[0] | occupiedBB[1]) ^ BITSET(kingpos[side]); // no king
     int from;
 
+    #ifdef ATTACKMAPS
+    // only sliders giving check see through the king
+    U64 out = sideAttacks[opponent];
+    U64 checkers = checkBB & ~pieceBB[WPAWN | opponent] & ~pieceBB[WKNIGHT | opponent];
+    while (checkers)
+    {
+        from = popLsb(&checkers);
+        out |= getAttackSet(from, occ);
+    }
+    #else
     U64 out = PAWNATTACKS(opponent, pieceBB[WPAWN | opponent]);
     U64 knights = pieceBB[(WKNIGHT | opponent)];
 
@@ -246,10 +264,62 @@ U64 Position::tabooSquares() const //gets all squares attacked by opponent (incl
         from = popLsb(&rooksQueens);
         out |= rookAttacks(occ, from);
     }
+    #endif // ATTACKMAPS
 
     return out;
 }
 
+#ifdef ATTACKMAPS
+/// Refresh the attack maps after the pieces on the squares in changed have moved.
+/// Any slider whose attacks reach a changed square had its ray blocked or opened there.
+void Position::update_attacks(U64 changed)
+{
+    U64 occ = occupiedBB[0] | occupiedBB[1];
+    U64 sliders = (pieceBB[WBISHOP] | pieceBB[BBISHOP] | pieceBB[WROOK] | pieceBB[BROOK] | pieceBB[WQUEEN] | pieceBB[BQUEEN]) & ~changed;
+    U64 squares = changed;
+    int sq;
+
+    while (squares)
+    {
+        sq = popLsb(&squares);
+        PieceCode pc = mailbox[sq];
+        attacksFrom[sq] = (pc >> 1) == PAWN ? PAWN_ATTACKS[pc & 1][sq] : getAttackSet(sq, occ);
+    }
+
+    while (sliders)
+    {
+        sq = popLsb(&sliders);
+        if (attacksFrom[sq] & changed)
+            attacksFrom[sq] = getAttackSet(sq, occ);
+    }
+
+    sideAttacks[WHITE] = sideAttacks[BLACK] = 0;
+    for (int side = WHITE; side <= BLACK; side++)
+    {
+        U64 pieces = occupiedBB[side];
+        while (pieces)
+            sideAttacks[side] |= attacksFrom[popLsb(&pieces)];
+    }
+}
+#endif // ATTACKMAPS
+
+#ifdef ATTACKMAPS
+inline U64 move_squares(Move m, Color side)
+{
+    int from = from_sq(m);
+    int to = to_sq(m);
+    U64 out = BITSET(from) | BITSET(to);
+    if (type_of(m) == CASTLING)
+    {
+        int castleType = 2 * side + ((to > from) ? 1 : 0);
+        out |= BITSET(castleKingTo[castleType]) | BITSET(castleRookTo[castleType]);
+    }
+    else if (type_of(m) == ENPASSANT)
+        out |= BITSET((from & 0x38) | (to & 0x07));
+    return out;
+}
+#endif // ATTACKMAPS
+
 void Position::set_piece_at(int sq, PieceCode pc)
 {
     int side = pc & 0x01;
@@ -286,15 +356,32 @@ void Position::move_piece(int from, int to, PieceCode pc)
 void Position::init()
 {
     init_boards();
+    init_simd_attacks();
+    init_nnue();
+    init_endgames();
     init_threads();
     init_values();
 }
 
+///The material table and the TT are most of the startup work and only matter once something is
+///evaluated or searched, so the first command that needs them builds them
+void init_search_tables()
+{
+    static bool materialReady = false;
+    if (!materialReady)
+    {
+        init_material();
+        materialReady = true;
+    }
+    alloc_tt();
+}
+
 void Position::do_null_move()
 {
     memcpy(&historyStack[historyIndex++], &key, sizeof(stateHistory));
     moveStack[historyIndex] = MOVE_NULL;
     halfmoveClock++;
+    nnue_push(*this);
 
     int eptnew = 0;
     key ^= zb.epSquares[epSquare];
@@ -302,6 +389,7 @@ void Position::do_null_move()
     key ^= zb.epSquares[epSquare];
     activeSide = ~activeSide;
     key ^= zb.activeSide;
+    updateCheckInfo();
 }
 
 void Position::undo_null_move()
@@ -311,11 +399,71 @@ void Position::undo_null_move()
     activeSide = ~activeSide;
 }
 
+U64 Position::key_after(Move m) const
+{
+    ///Zobrist-only version of do_move, ignoring a new en passant square
+    SpecialType type = type_of(m);
+    Color side = activeSide;
+    int from = from_sq(m);
+    int to = to_sq(m);
+    uint8_t newCastle;
+    U64 k = key ^ zb.activeSide ^ zb.epSquares[epSquare];
+
+    if (type == CASTLING)
+    {
+        int castleType = 2 * side + ((to > from) ? 1 : 0);
+        PieceCode kingpc = (PieceCode)(WKING | side);
+        PieceCode rookpc = (PieceCode)(WROOK | side);
+        k ^= zb.pieceKeys[(from << 4) | kingpc] ^ zb.pieceKeys[(castleKingTo[castleType] << 4) | kingpc];
+        k ^= zb.pieceKeys[(to << 4) | rookpc] ^ zb.pieceKeys[(castleRookTo[castleType] << 4) | rookpc];
+        newCastle = castleRights & (side ? ~(BQCMASK | BKCMASK) : ~(WQCMASK | WKCMASK));
+    }
+    else
+    {
+        PieceCode pc = mailbox[from];
+        PieceCode captured = mailbox[to];
+        if (captured != BLANK)
+            k ^= zb.pieceKeys[(to << 4) | captured];
+        else if (type == ENPASSANT)
+            k ^= zb.pieceKeys[(((from & 0x38) | (to & 0x07)) << 4) | make_piece(~side, PAWN)];
+        PieceCode landing = (type == PROMOTION) ? make_piece(side, promotion_type(m)) : pc;
+        k ^= zb.pieceKeys[(from << 4) | pc] ^ zb.pieceKeys[(to << 4) | landing];
+        newCastle = castleRights & castlerights[from] & castlerights[to];
+    }
+
+    return k ^ zb.castle[castleRights] ^ zb.castle[newCastle];
+}
+
+void Position::prefetch_after(Move m) const
+{
+    PREFETCH(&TT.table[key_after(m) & TT.size_mask]);
+
+    if (type_of(m) == CASTLING)
+        return;
+
+    int from = from_sq(m);
+    int to = to_sq(m);
+    PieceCode pc = mailbox[from];
+    PieceCode captured = (type_of(m) == ENPASSANT) ? make_piece(~activeSide, PAWN) : mailbox[to];
+    PieceType pt = PieceType(pc >> 1);
+
+    if (pt == PAWN || pt == KING || (captured >> 1) == PAWN)
+    {
+        U64 pk = pawnhash ^ zb.pieceKeys[(from << 4) | pc];
+        if (type_of(m) != PROMOTION)
+            pk ^= zb.pieceKeys[(to << 4) | pc];
+        if ((captured >> 1) == PAWN)
+            pk ^= zb.pieceKeys[((type_of(m) == ENPASSANT ? (from & 0x38) | (to & 0x07) : to) << 4) | captured];
+        PREFETCH(&my_thread->pawntable[pk & my_thread->pawntableMask]);
+    }
+}
+
 void Position::do_move(Move m)
 {
     memcpy(&historyStack[historyIndex++], &key, sizeof(stateHistory));
     moveStack[historyIndex] = m;
     halfmoveClock++;
+    NNUEAccumulator *acc = nnue_push(*this);
     SpecialType type = type_of(m);
     capturedPiece = BLANK;
     int eptnew = 0;
@@ -337,6 +485,11 @@ void Position::do_move(Move m)
         kingpos[side] = kingTo;
         move_piece(kingFrom, kingTo, kingpc);
         move_piece(rookFrom, rookTo, rookpc);
+        if (acc)
+        {
+            nnue_dirty(acc, kingpc, kingFrom, kingTo);
+            nnue_dirty(acc, rookpc, rookFrom, rookTo);
+        }
         pawnhash ^= zb.pieceKeys[(kingFrom << 4) | kingpc] ^ zb.pieceKeys[(kingTo << 4) | kingpc];
 
         castleRights &= (side ? ~(BQCMASK | BKCMASK) : ~(WQCMASK | WKCMASK)); //clear castling rights
@@ -354,12 +507,19 @@ void Position::do_move(Move m)
             PieceCode promote = make_piece(side, promotion_type(m));
             set_piece_at(to, promote);
             remove_piece_at(from, pc);
+            if (acc)
+            {
+                nnue_dirty(acc, pc, from, 64);
+                nnue_dirty(acc, promote, 64, to);
+            }
             pawnhash ^= zb.pieceKeys[(from << 4) | pc];
             materialhash ^= zb.pieceKeys[(pieceCount[pc] << 4) | pc] ^ zb.pieceKeys[((pieceCount[promote] - 1) << 4) | promote];
         }
         else
         {
             move_piece(from, to, pc);
+            if (acc)
+                nnue_dirty(acc, pc, from, to);
 
             if (pt == PAWN)
             {
@@ -379,6 +539,8 @@ void Position::do_move(Move m)
 
         if (capturedPiece != BLANK)
         {
+            if (acc)
+                nnue_dirty(acc, capturedPiece, type == ENPASSANT ? (from & 0x38) | (to & 0x07) : to, 64);
             if (capturedPiece >> 1 == PAWN)
             {
                 if (type == ENPASSANT)
@@ -397,8 +559,8 @@ void Position::do_move(Move m)
         castleRights &= (castlerights[from] & castlerights[to]);
     }
 
-    PREFETCH(&my_thread->pawntable[pawnhash & PAWN_HASH_SIZE_MASK]);
-    PREFETCH(&my_thread->materialTable[materialhash & MATERIAL_HASH_SIZE_MASK]);
+    if (my_thread)
+        PREFETCH(&my_thread->pawntable[pawnhash & my_thread->pawntableMask]);
 
     activeSide = ~activeSide;
     if (!activeSide)
@@ -411,9 +573,15 @@ void Position::do_move(Move m)
     key ^= zb.castle[oldCastle] ^ zb.castle[castleRights];
 
     PREFETCH(&TT.table[key & TT.size_mask]);
+    if (my_thread)
+        PREFETCH(&my_thread->evalCache[key & my_thread->evalCacheMask]);
 
+    #ifdef ATTACKMAPS
+    update_attacks(move_squares(m, side));
+    #endif // ATTACKMAPS
     checkBB = attackersTo(kingpos[activeSide], activeSide ^ SIDESWITCH);
     updateBlockers();
+    updateCheckInfo();
 }
 
 void Position::undo_move(Move m)
@@ -472,6 +640,9 @@ void Position::undo_move(Move m)
     }
     historyIndex--;
     memcpy(&key, &historyStack[historyIndex], sizeof(stateHistory));
+    #ifdef ATTACKMAPS
+    update_attacks(move_squares(m, side));
+    #endif // ATTACKMAPS
 }
 
 bool Position::isCapture(Move m) const
@@ -516,7 +687,7 @@ bool Position::isPseudoLegal(const Move m) const
                 && !mailbox[(to - pawn_push(side))]))
             return false;
     }
-    else if (!(getAttackSet(from, (occupiedBB[0] | occupiedBB[1])) & BITSET(to)))
+    else if (!(ATTACKS_FROM(*this, from, (occupiedBB[0] | occupiedBB[1])) & BITSET(to)))
         return false;
 
     if (checkBB)
@@ -594,105 +765,52 @@ bool Position::advanced_pawn_push(Move m) const
 
 bool Position::givesCheck(Move m) //assumes move is legal
 {
-    Color opponent = ~activeSide;
-    int opponentKing_square = kingpos[opponent];
-    U64 opponentKing = BITSET(opponentKing_square);
+    Color side = activeSide;
+    int opponentKing_square = kingpos[~side];
     SpecialType mtype = type_of(m);
 
     int from = from_sq(m);
     int to = to_sq(m);
-    PieceCode pc = mailbox[from];
-    PieceType type = PieceType(pc >> 1);
-    U64 occ = occupiedBB[0] | occupiedBB[1];
-
-    switch (type)
-    {
-    case PAWN:
-        if (PAWN_ATTACKS[activeSide][to] & opponentKing)
-            return true;
-        if (!(opponentKing & RAY_MASKS[from][to]) && (blockersForKing[opponent][0] | blockersForKing[opponent][1]) & BITSET(from))
-            return true;
-        if (mtype == PROMOTION)
-        {
-            PieceType promotion = promotion_type(m);
-            switch (promotion)
-            {
-            case QUEEN:
-                return (opponentKing & (rookAttacks(occ, to) | bishopAttacks(occ, to)));
-            case ROOK:
-                return (opponentKing & (rookAttacks(occ, to)));
-            case BISHOP:
-                return (opponentKing & (bishopAttacks(occ, to)));
-            case KNIGHT:
-                return (opponentKing & (PseudoAttacks[KNIGHT][to]));
-            default:
-                return false;
-            }
-        }
-        if (mtype == ENPASSANT)
-        {
-            do_move(m);
-            if (checkBB)
-            {
-                undo_move(m);
-                return true;
-            }
-            undo_move(m);
-        }
-        break;
-
-    case KING:
-        if (!(opponentKing & RAY_MASKS[from][to]) && (blockersForKing[opponent][0] | blockersForKing[opponent][1]) & BITSET(from))
-            return true;
-
-        if (mtype == CASTLING)
-        {
-            do_move(m);
-            if (checkBB)
-            {
-                undo_move(m);
-                return true;
-            }
-            undo_move(m);
-        }
-        break;
-
-    case QUEEN:
-        if (opponentKing & (rookAttacks(occ, to) | bishopAttacks(occ, to)))
-            return true;
-        if (!(opponentKing & RAY_MASKS[from][to]) && (blockersForKing[opponent][0] | blockersForKing[opponent][1]) & BITSET(from))
-            return true;
-
-        break;
-
-    case ROOK:
-        if (opponentKing & (rookAttacks(occ, to)))
-            return true;
-        if (!(opponentKing & RAY_MASKS[from][to]) && (blockersForKing[opponent][0] | blockersForKing[opponent][1]) & BITSET(from))
-            return true;
+    PieceType type = PieceType(mailbox[from] >> 1);
 
-        break;
+    ///Direct check
+    if (checkSquares[type] & BITSET(to))
+        return true;
 
-    case BISHOP:
-        if (opponentKing & (bishopAttacks(occ, to)))
-            return true;
-        if (!(opponentKing & RAY_MASKS[from][to]) && (blockersForKing[opponent][0] | blockersForKing[opponent][1]) & BITSET(from))
-            return true;
+    ///Discovered check
+    if ((dcCandidates & BITSET(from)) && !(BITSET(opponentKing_square) & RAY_MASKS[from][to]))
+        return true;
 
-        break;
+    switch (mtype)
+    {
+    case PROMOTION:
+        return checkSquares[promotion_type(m)] & BITSET(to);
 
-    case KNIGHT:
-        if (opponentKing & PseudoAttacks[KNIGHT][to])
-            return true;
-        if (!(opponentKing & RAY_MASKS[from][to]) && (blockersForKing[opponent][0] | blockersForKing[opponent][1]) & BITSET(from))
-            return true;
+    case ENPASSANT:
+    {
+        ///The captured pawn may have been the only piece between one of our sliders and the king
+        int capturesquare = (from & 0x38) | (to & 0x07);
+        U64 occ = ((occupiedBB[0] | occupiedBB[1]) ^ BITSET(from) ^ BITSET(capturesquare)) | BITSET(to);
+        U64 queens = pieceBB[WQUEEN | side];
+        return (rookAttacks(occ, opponentKing_square) & (pieceBB[WROOK | side] | queens))
+            || (bishopAttacks(occ, opponentKing_square) & (pieceBB[WBISHOP | side] | queens));
+    }
 
-        break;
+    case CASTLING:
+    {
+        int castleType = 2 * side + ((to > from) ? 1 : 0);
+        int kingTo = castleKingTo[castleType];
+        int rookTo = castleRookTo[castleType];
+        U64 occ = ((occupiedBB[0] | occupiedBB[1]) ^ BITSET(from) ^ BITSET(to)) | BITSET(kingTo) | BITSET(rookTo);
+        U64 queens = pieceBB[WQUEEN | side];
+        U64 rooks = ((pieceBB[WROOK | side] ^ BITSET(to)) | BITSET(rookTo)) | queens;
+        return (rookAttacks(occ, opponentKing_square) & rooks)
+            || (bishopAttacks(occ, opponentKing_square) & (pieceBB[WBISHOP | side] | queens));
+    }
 
     default:
         return false;
     }
-    return false;
 }
 
 
@@ -766,6 +884,62 @@ bool Position::see(Move m, int threshold) const
     return activeSide_temp ^ activeSide;
 }
 
+/// Exchange value of a move: a swap list of the captures on the target square, smallest attacker first,
+/// with x-rays added as pieces leave, then negamaxed back so either side may stop capturing.
+/// Agrees with see(): see(m, t) == (see_value(m) >= t).
+int Position::see_value(Move m) const
+{
+    int from = from_sq(m);
+    int to = to_sq(m);
+    int gain[32];
+    int d = 0;
+
+    gain[0] = pieceValues[MG][mailbox[to]] + ((type_of(m) == PROMOTION) ? (pieceValues[MG][promotion_type(m) << 1] - PAWN_MG) : 0);
+    int nextPiece = (type_of(m) == PROMOTION) ? promotion_type(m) << 1 : mailbox[from];
+
+    U64 occ = ((occupiedBB[0] | occupiedBB[1]) ^ BITSET(from)) | BITSET(to);
+    U64 rooks = (pieceBB[WROOK] | pieceBB[BROOK] | pieceBB[WQUEEN] | pieceBB[BQUEEN]);
+    U64 bishops = (pieceBB[WBISHOP] | pieceBB[BBISHOP] | pieceBB[WQUEEN] | pieceBB[BQUEEN]);
+
+    U64 attackers = all_attackers_to(to, occ) & occ;
+    Color activeSide_temp = ~activeSide;
+
+    while (true)
+    {
+        U64 my_attackers = attackers & occupiedBB[activeSide_temp];
+        if (!my_attackers)
+            break;
+
+        int sq = smallestAttacker(my_attackers, activeSide_temp);
+        d++;
+        gain[d] = pieceValues[MG][nextPiece] - gain[d - 1];
+        nextPiece = mailbox[sq];
+
+        occ ^= BITSET(sq);
+        int attackerType = nextPiece >> 1;
+        if (attackerType == PAWN || attackerType == BISHOP || attackerType == QUEEN)
+        {
+            attackers |= bishopAttacks(occ, to) & bishops;
+        }
+
+        if (attackerType == ROOK || attackerType == QUEEN)
+        {
+            attackers |= rookAttacks(occ, to) & rooks;
+        }
+
+        attackers &= occ;
+        activeSide_temp = ~activeSide_temp;
+    }
+
+    while (d)
+    {
+        gain[d - 1] = min(gain[d - 1], -gain[d]);
+        d--;
+    }
+
+    return gain[0];
+}
+
 bool Position::testRepetition() const
 {
     int minIndex = max(historyIndex - halfmoveClock, 0);
@@ -211,7 +211,7 @@ bool isDraw(Position *pos)
         }
     }
 // TODO (drstrange767#1#): verify material entry or just do a straight check ... or both???
-    if (get_materialEntry(*pos)->isDrawn)
+    if (probeMaterial(*pos)->isDrawn)
     {
         return true;
     }
@@ -271,8 +271,9 @@ int qSearch(SearchThread *thread, searchInfo *info, int depth, int alpha, const
     Move hashMove = MOVE_NONE;
     int hashScore = UNDEFINED;
     bool ttHit;
-    TTEntry *tte = probeTT(pos->key, ttHit);
-    uint8_t flag = tte_flag(tte);
+    TTEntry tte;
+    TTEntry *slot = probeTT(pos->key, ttHit, tte);
+    uint8_t flag = tte_flag(&tte);
 
     info->chosenMove = MOVE_NONE;
     (info+1)->ply = ply + 1;
@@ -281,8 +282,8 @@ int qSearch(SearchThread *thread, searchInfo *info, int depth, int alpha, const
 
     if (ttHit)
     {
-        hashMove = Move(tte->movecode);
-        hashScore = tt_to_score(tte->value, ply);
+        hashMove = Move(tte.movecode);
+        hashScore = tt_to_score(tte.value, ply);
         if (!is_pv &&
             (flag == FLAG_EXACT ||
              (flag == FLAG_BETA && hashScore >= beta) ||
@@ -298,8 +299,8 @@ int qSearch(SearchThread *thread, searchInfo *info, int depth, int alpha, const
     if (!in_check) // stand pat
     {
         bool is_null = (info-1)->chosenMove == MOVE_NULL;
-        if (ttHit && tte->static_eval != UNDEFINED)
-            info->staticEval = bestScore = tte->static_eval;
+        if (ttHit && tte.static_eval != UNDEFINED)
+            info->staticEval = bestScore = tte.static_eval;
         else if (is_null)
             info->staticEval = bestScore = tempo * 2 - (info-1)->staticEval;
         else
@@ -326,7 +327,8 @@ int qSearch(SearchThread *thread, searchInfo *info, int depth, int alpha, const
 
     if (STACKTRACE) globalState = 3;
 
-    MoveGen movegen = MoveGen(pos, QUIESCENCE_SEARCH, hashMove, 0, depth);
+    SMove *moveTop = thread->moveTop;
+    MoveGen movegen(pos, QUIESCENCE_SEARCH, hashMove, 0, depth);
     Move bestMove = MOVE_NONE;
     int moveCount = 0;
     Move m;
@@ -335,8 +337,9 @@ int qSearch(SearchThread *thread, searchInfo *info, int depth, int alpha, const
     while((m = movegen.next_move(info, depth)) != MOVE_NONE)
     {
         moveCount++;
+        pos->prefetch_after(m);
 
-        if ((!in_check) && !pos->see(m, 0))
+        if ((!in_check) && !movegen.see(m, 0))
             continue;
 
         int16_t history, counter, followup;
@@ -379,7 +382,8 @@ int qSearch(SearchThread *thread, searchInfo *info, int depth, int alpha, const
                 }
                 else //Beta cutoff
                 {
-                    storeEntry(tte, pos->key, m, 0, score_to_tt(score, ply), info->staticEval, FLAG_BETA);
+                    storeEntry(slot, pos->key, m, 0, score_to_tt(score, ply), info->staticEval, FLAG_BETA, is_pv);
+                    thread->moveTop = moveTop;
                     return score;
                 }
             }
@@ -388,10 +392,12 @@ int qSearch(SearchThread *thread, searchInfo *info, int depth, int alpha, const
 
     if (STACKTRACE) globalState = 6;
 
+    thread->moveTop = moveTop;
+
     if (moveCount == 0 && in_check)
         return VALUE_MATED + ply;
     uint8_t return_flag = (is_pv && bestMove) ? FLAG_EXACT : FLAG_ALPHA;
-    storeEntry(tte, pos->key, bestMove, 0, score_to_tt(bestScore, ply), info->staticEval, return_flag);
+    storeEntry(slot, pos->key, bestMove, 0, score_to_tt(bestScore, ply), info->staticEval, return_flag, is_pv);
 
     return bestScore;
 }
@@ -461,15 +467,16 @@ int alphaBeta(SearchThread *thread, searchInfo *info, int depth, int alpha, int
 
     /// Hash table probe
     bool ttHit;
-    TTEntry *tte = probeTT(newHash, ttHit);
-    uint8_t flag = tte_flag(tte);
+    TTEntry tte;
+    TTEntry *slot = probeTT(newHash, ttHit, tte);
+    uint8_t flag = tte_flag(&tte);
 
     if (ttHit)
     {
-        hashMove = tte->movecode;
-        if (tte->depth >= depth)
+        hashMove = tte.movecode;
+        if (tte.depth >= depth)
         {
-            hashScore = tt_to_score(tte->value, ply);
+            hashScore = tt_to_score(tte.value, ply);
             if (!is_pv &&
                 hashScore != UNDEFINED &&
                 (flag == FLAG_EXACT ||
@@ -494,9 +501,9 @@ int alphaBeta(SearchThread *thread, searchInfo *info, int depth, int alpha, int
                  }
         }
         #if 0
-        else if (num_threads == 1 && tte->depth >= depth - 1)
+        else if (num_threads == 1 && tte.depth >= depth - 1)
         {
-            hashScore = tt_to_score(tte->value, ply);
+            hashScore = tt_to_score(tte.value, ply);
             if (!is_pv &&
                 hashScore != UNDEFINED &&
                 ((flag == FLAG_BETA && hashScore >= beta + 100) ||
@@ -526,7 +533,7 @@ int alphaBeta(SearchThread *thread, searchInfo *info, int depth, int alpha, int
             || (ttBound == FLAG_BETA && tb_value >= beta)
             || (ttBound == FLAG_ALPHA && tb_value <= alpha)) {
 
-            storeEntry(tte, pos->key, MOVE_NONE, depth, score_to_tt(tb_value, ply), UNDEFINED, ttBound);
+            storeEntry(slot, pos->key, MOVE_NONE, depth, score_to_tt(tb_value, ply), UNDEFINED, ttBound, is_pv);
             return tb_value;
         }
     }
@@ -539,9 +546,9 @@ int alphaBeta(SearchThread *thread, searchInfo *info, int depth, int alpha, int
 
     if (!in_check)
     {
-        if (ttHit && tte->static_eval != UNDEFINED)
+        if (ttHit && tte.static_eval != UNDEFINED)
         {
-            info->staticEval = /*(tte->depth > 5 && hashScore != UNDEFINED) ? hashScore : */tte->static_eval;
+            info->staticEval = /*(tte.depth > 5 && hashScore != UNDEFINED) ? hashScore : */tte.static_eval;
         }
         else if (is_null)
         {
@@ -610,10 +617,11 @@ int alphaBeta(SearchThread *thread, searchInfo *info, int depth, int alpha, int
     ///Probcut
     ///////////////////////////////////////////////////SECTION UNDER REVIEW//////////////////////////////////////////////////////////
     Move m;
+    SMove *moveTop = thread->moveTop;
     if (!in_check && !is_pv && depth > 4 && abs(beta) < MATE_IN_MAX_PLY && info->staticEval + qSearchDelta(pos) >= beta + ProbCutMargin)
     {
         int rbeta = min(beta + ProbCutMargin, int(VALUE_MATE));
-        MoveGen movegen = MoveGen(pos, PROBCUT_SEARCH, hashMove, rbeta - info->staticEval, depth);
+        MoveGen movegen(pos, PROBCUT_SEARCH, hashMove, rbeta - info->staticEval, depth);
         while((m = movegen.next_move(info, depth)) != MOVE_NONE)
         {
             if (m != excluded_move)
@@ -632,13 +640,17 @@ int alphaBeta(SearchThread *thread, searchInfo *info, int depth, int alpha, int
                 pos->undo_move(m);
 
                 if (value >= rbeta)
+                {
+                    thread->moveTop = moveTop;
                     return value;
+                }
             }
         }
+        thread->moveTop = moveTop;
     }
     ///////////////////////////////////////////////////SECTION UNDER REVIEW//////////////////////////////////////////////////////////
 
-    MoveGen movegen = MoveGen(pos, NORMAL_SEARCH, hashMove, 0, depth);
+    MoveGen movegen(pos, NORMAL_SEARCH, hashMove, 0, depth);
     Move bestMove = MOVE_NONE;
     int bestScore = -VALUE_INF;
 
@@ -658,6 +670,7 @@ int alphaBeta(SearchThread *thread, searchInfo *info, int depth, int alpha, int
             continue;
 
         num_moves++;
+        pos->prefetch_after(m);
 
         bool givesCheck = pos->givesCheck(m);
         bool isTactical = (pos->isTactical(m));
@@ -684,10 +697,10 @@ int alphaBeta(SearchThread *thread, searchInfo *info, int depth, int alpha, int
                 if (!isRoot && depth <= 5 && counter < 0 && followup < 0)
                     continue;
 
-                if (depth < 9 && !pos->see(m, -10*depth*depth))
+                if (depth < 9 && !movegen.see(m, -10*depth*depth))
                     continue;
             }
-            else if (movegen.state > TACTICAL_STATE && !pos->see(m, -PAWN_EG * depth)) // is a bad tactical move with very low SEE
+            else if (movegen.state > TACTICAL_STATE && !movegen.see(m, -PAWN_EG * depth)) // is a bad tactical move with very low SEE
                 continue;
         }
 
@@ -695,7 +708,7 @@ int alphaBeta(SearchThread *thread, searchInfo *info, int depth, int alpha, int
 
         ///Singular extension search
         if (depth >= singularDepth && m == hashMove && !isRoot && excluded_move == MOVE_NONE
-            && abs(hashScore) < WON_ENDGAME && (flag & FLAG_BETA) && tte->depth >= depth - 2 && !pos->gameCycle) // Don't singularly extend if we've been here before (what's the point?)
+            && abs(hashScore) < WON_ENDGAME && (flag & FLAG_BETA) && tte.depth >= depth - 2 && !pos->gameCycle) // Don't singularly extend if we've been here before (what's the point?)
         {
             int singularBeta = hashScore - 2 * depth;
             int halfDepth = depth / 2;
@@ -710,7 +723,10 @@ int alphaBeta(SearchThread *thread, searchInfo *info, int depth, int alpha, int
             }
 
             else if (singularBeta >= beta)
+            {
+                thread->moveTop = moveTop;
                 return singularBeta;
+            }
 
         }
         ///////////////////////////////////////////////////SECTION UNDER REVIEW//////////////////////////////////////////////////////////
@@ -719,7 +735,7 @@ int alphaBeta(SearchThread *thread, searchInfo *info, int depth, int alpha, int
 
         else
         {
-            if (givesCheck && (pos->see(m, 0)))
+            if (givesCheck && (movegen.see(m, 0)))
                 extension = 1;
             else if (depth < 3 && pos->advanced_pawn_push(m))
                 extension = 1;
@@ -821,6 +837,8 @@ int alphaBeta(SearchThread *thread, searchInfo *info, int depth, int alpha, int
 
     if (STACKTRACE) globalState = 20;
 
+    thread->moveTop = moveTop;
+
     if (num_moves == 0)
     {
         bestScore = excluded_move != MOVE_NONE ? alpha : in_check ? VALUE_MATED + ply : 0;
@@ -832,7 +850,7 @@ int alphaBeta(SearchThread *thread, searchInfo *info, int depth, int alpha, int
 
     if (excluded_move == MOVE_NONE)
     {
-        storeEntry(tte, pos->key, bestMove, depth, score_to_tt(bestScore, ply), info->staticEval, (is_pv && bestMove) ? FLAG_EXACT : FLAG_ALPHA);
+        storeEntry(slot, pos->key, bestMove, depth, score_to_tt(bestScore, ply), info->staticEval, (is_pv && bestMove) ? FLAG_EXACT : FLAG_ALPHA, is_pv);
     }
 
     return bestScore;
@@ -899,7 +917,12 @@ void *aspiration_thread(void *t)
             if ((actualSearchDepth + cycle) % SkipDepths[cycle] == 0)
                 actualSearchDepth += SkipSize[cycle];
         }
-        if (setjmp(thread->jbuffer)) break;
+        if (setjmp(thread->jbuffer))
+        {
+            ///the jump skipped every node's release of its move list
+            thread->moveTop = thread->moveBuffer;
+            break;
+        }
 
         while (true)
         {
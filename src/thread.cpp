@@ -19,6 +19,51 @@
 #include "Beef.h"
 
 int num_threads = 1;
+int evalCacheMB = EVALCACHE_MB;
+int pawnHashMB = PAWNHASH_MB;
+
+void alloc_eval_cache(SearchThread *t)
+{
+    U64 entries = (U64)evalCacheMB * 1024 * 1024 / sizeof(U64);
+    while (MORETHANONE(entries))
+        entries &= entries - 1;
+    delete[] t->evalCache;
+    t->evalCache = new U64[entries]();
+    t->evalCacheMask = entries - 1;
+}
+
+void resize_eval_caches(int mbSize)
+{
+    evalCacheMB = mbSize;
+    for (int i = 0; i < num_threads; i++)
+        alloc_eval_cache((SearchThread*)get_thread(i));
+}
+
+void clear_eval_caches()
+{
+    for (int i = 0; i < num_threads; i++)
+    {
+        SearchThread *t = (SearchThread*)get_thread(i);
+        memset(t->evalCache, 0, (t->evalCacheMask + 1) * sizeof(U64));
+    }
+}
+
+void alloc_pawn_table(SearchThread *t)
+{
+    U64 entries = (U64)pawnHashMB * 1024 * 1024 / sizeof(pawnhashEntry);
+    while (MORETHANONE(entries))
+        entries &= entries - 1;
+    delete[] t->pawntable;
+    t->pawntable = new pawnhashEntry[entries]();
+    t->pawntableMask = entries - 1;
+}
+
+void resize_pawn_tables(int mbSize)
+{
+    pawnHashMB = mbSize;
+    for (int i = 0; i < num_threads; i++)
+        alloc_pawn_table((SearchThread*)get_thread(i));
+}
 
 void get_ready() {
 
@@ -35,6 +80,7 @@ void get_ready() {
     {
         SearchThread *t = (SearchThread*)get_thread(i);
         t->doNMP = true;
+        t->moveTop = t->moveBuffer;
 
         for (int j = 0; j < MAX_PLY + 3; j++) {
             searchInfo *info = &t->ss[j];
@@ -48,7 +94,6 @@ void get_ready() {
             info->killers[0] = info->killers[1] = MOVE_NONE;
             info->counterMove_history = &t->counterMove_history[BLANK][0];
         }
-        memset(&t->pawntable, 0 , sizeof(t->pawntable));
     }
 }
 
@@ -56,6 +101,10 @@ void clear_threads() {
     for (int i = 0; i < num_threads; i++) {
         SearchThread *search_thread = (SearchThread*)get_thread(i);
 
+        // Clear pawn and material entries, which are otherwise kept from one search to the next
+        memset(search_thread->pawntable, 0, (search_thread->pawntableMask + 1) * sizeof(pawnhashEntry));
+        memset(&search_thread->materialOverflow, 0, sizeof(search_thread->materialOverflow));
+
         // Clear history
         std::memset(&search_thread->historyTable, 0, sizeof(search_thread->historyTable));
         //initialize history
@@ -79,12 +128,20 @@ void clear_threads() {
 }
 
 void reset_threads(int thread_num) {
+    for (int i = 1; i < num_threads; i++) {
+        delete[] ((SearchThread*)get_thread(i))->evalCache;
+        delete[] ((SearchThread*)get_thread(i))->pawntable;
+    }
     num_threads = thread_num;
     delete[] search_threads;
     search_threads = new SearchThread[num_threads - 1];
 
     for (int i = 1; i < thread_num; i++) {
         ((SearchThread*)get_thread(i))->thread_id = i;
+        ((SearchThread*)get_thread(i))->evalCache = nullptr;
+        alloc_eval_cache((SearchThread*)get_thread(i));
+        ((SearchThread*)get_thread(i))->pawntable = nullptr;
+        alloc_pawn_table((SearchThread*)get_thread(i));
     }
     clear_threads();
     get_ready();
@@ -95,6 +152,10 @@ void init_threads() {
 
     for (int i = 0; i < num_threads; i++) {
         ((SearchThread*)get_thread(i))->thread_id = i;
+        ((SearchThread*)get_thread(i))->evalCache = nullptr;
+        alloc_eval_cache((SearchThread*)get_thread(i));
+        ((SearchThread*)get_thread(i))->pawntable = nullptr;
+        alloc_pawn_table((SearchThread*)get_thread(i));
     }
     clear_threads();
 }
@@ -18,21 +18,64 @@
 
 #include "Beef.h"
 
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
 transpositionTable TT;
 
+#ifdef TTSTATS
+ttStatistics ttstats;
+#endif // TTSTATS
+
 void init_tt()
 {
     size_t MB = TRANSPOSITION_MB;
 
     TT.table_size = MB *1024 * 1024;
     TT.size_mask = uint64_t(TT.table_size / sizeof(TTBucket) - 1);
+    TT.table = nullptr;
+}
+
+///The table is allocated by the first command that needs it instead of at startup, so a Hash
+///setting sent before then costs a single allocation and "uci" is answered right away
+void alloc_tt()
+{
+    if (TT.table)
+        return;
+
     TT.table = (TTBucket *)aligned_ttmem_alloc(TT.table_size, TT.mem);
+    if (!TT.mem)
+    {
+        std::cerr << "Failed to allocate " << TT.table_size / (1024 * 1024)
+                << "MB for transposition table." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
     clear_tt();
 }
 
 void reset_tt(int mbSize)
 {
-    free(TT.mem);
+    if (TT.shared)
+    {
+        detach_shared_tt();
+        ///keep sharing, the segment decides the size if another process created it first
+        if (attach_shared_tt(sharedHashName, mbSize))
+            return;
+    }
+    else if (!TT.table)
+    {
+        TT.table_size = (uint64_t)mbSize * 1024 * 1024;
+        TT.size_mask = uint64_t(TT.table_size / sizeof(TTBucket) - 1);
+        return;
+    }
+    else
+        free(TT.mem);
 
     TT.table_size = (uint64_t)mbSize * 1024 * 1024;
     TT.size_mask = uint64_t(TT.table_size / sizeof(TTBucket) - 1);
@@ -47,6 +90,126 @@ void reset_tt(int mbSize)
     clear_tt();
 }
 
+string sharedHashName;
+
+static const uint32_t SHARED_TT_MAGIC = 0x42454546; // "BEEF"
+static const uint32_t SHARED_TT_VERSION = 2; // bump whenever the TTEntry encoding changes
+static const size_t SHARED_TT_HEADER = 4096; // keep the buckets page aligned
+static const int SHARED_TT_WAIT_MS = 2000; // how long an attacher waits for the creator to publish
+
+bool attach_shared_tt(string name, int mbSize)
+{
+    #if !defined(_WIN32) && !defined(_WIN64)
+    string path = "/" + name;
+    U64 tableSize = (uint64_t)mbSize * 1024 * 1024;
+
+    ///exactly one process wins the O_EXCL create and initialises the segment, everybody else attaches
+    bool created = true;
+    int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+    if (fd < 0 && errno == EEXIST)
+    {
+        created = false;
+        fd = shm_open(path.c_str(), O_RDWR, 0666);
+    }
+    if (fd < 0)
+    {
+        cout << "info string Could not open shared hash " << path << endl;
+        return false;
+    }
+
+    if (created)
+    {
+        ///a new segment is zero filled, which is an empty table
+        if (ftruncate(fd, SHARED_TT_HEADER + tableSize))
+        {
+            cout << "info string Could not size shared hash " << path << endl;
+            close(fd);
+            shm_unlink(path.c_str());
+            return false;
+        }
+    }
+    else
+    {
+        ///the creator may not have sized the segment yet
+        struct stat st;
+        int waited = 0;
+        while (!fstat(fd, &st) && (U64)st.st_size <= SHARED_TT_HEADER && waited++ < SHARED_TT_WAIT_MS)
+            usleep(1000);
+        if ((U64)st.st_size <= SHARED_TT_HEADER)
+        {
+            cout << "info string Shared hash " << path << " was never initialised" << endl;
+            close(fd);
+            return false;
+        }
+        tableSize = (U64)st.st_size - SHARED_TT_HEADER;
+    }
+
+    size_t mapSize = SHARED_TT_HEADER + tableSize;
+    void *mem = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+    {
+        cout << "info string Could not map shared hash " << path << endl;
+        if (created)
+            shm_unlink(path.c_str());
+        return false;
+    }
+
+    sharedTTHeader *header = (sharedTTHeader *)mem;
+    if (created)
+    {
+        header->version = SHARED_TT_VERSION;
+        header->bucketSize = sizeof(TTBucket);
+        header->table_size = tableSize;
+        ///publishing the magic last tells attachers the rest of the header is valid
+        header->magic.store(SHARED_TT_MAGIC, std::memory_order_release);
+    }
+    else
+    {
+        int waited = 0;
+        while (!header->magic.load(std::memory_order_acquire) && waited++ < SHARED_TT_WAIT_MS)
+            usleep(1000);
+        if (header->magic.load(std::memory_order_acquire) != SHARED_TT_MAGIC || header->version != SHARED_TT_VERSION
+            || header->bucketSize != sizeof(TTBucket) || header->table_size != tableSize
+            || MORETHANONE(tableSize / sizeof(TTBucket)))
+        {
+            cout << "info string Shared hash " << path << " has an incompatible layout" << endl;
+            munmap(mem, mapSize);
+            return false;
+        }
+    }
+
+    if (!TT.shared)
+        free(TT.mem);
+    TT.mem = nullptr;
+    TT.shared = header;
+    TT.shared_size = mapSize;
+    TT.table = (TTBucket *)((char *)mem + SHARED_TT_HEADER);
+    TT.table_size = tableSize;
+    TT.size_mask = uint64_t(TT.table_size / sizeof(TTBucket) - 1);
+    TT.generation = header->generation;
+    sharedHashName = name;
+
+    if (tableSize != (uint64_t)mbSize * 1024 * 1024)
+        cout << "info string Shared hash " << path << " already exists, using its size of " << tableSize / (1024 * 1024) << "MB" << endl;
+    return true;
+    #else
+    (void)mbSize;
+    cout << "info string Shared hash " << name << " is not supported on this platform" << endl;
+    return false;
+    #endif
+}
+
+void detach_shared_tt()
+{
+    #if !defined(_WIN32) && !defined(_WIN64)
+    if (TT.shared)
+        munmap(TT.shared, TT.shared_size);
+    #endif
+    TT.shared = nullptr;
+    TT.table = nullptr;
+}
+
 void clear_tt()
 {
     /*size_t totalsize = TT.table_size;
@@ -63,9 +226,12 @@ void clear_tt()
         if (tthread[i].joinable())
             tthread[i].join();
     }*/
-    memset(TT.table, 0, TT.table_size);
+    if (TT.table)
+        memset(TT.table, 0, TT.table_size);
 
     TT.generation = 0;
+    if (TT.shared)
+        TT.shared->generation = 0;
 }
 
 int hashfull()
@@ -97,68 +263,196 @@ int tt_to_score(int score, uint16_t ply) {
     }
 }
 
-void storeEntry(TTEntry *entry, U64 key, Move m, int depth, int score, int staticEval, uint8_t flag)
+inline U64 tte_data(const TTEntry *entry)
+{
+    U64 data;
+    memcpy(&data, &entry->movecode, sizeof(U64));
+    return data;
+}
+
+inline uint16_t tte_fold(U64 data)
+{
+    return (uint16_t)(data ^ (data >> 16) ^ (data >> 32) ^ (data >> 48));
+}
+
+int age_diff(TTEntry *tte) {
+    return (TT.generation - tte_age(tte)) & 0x1F;
+}
+
+///entries from this search that are exact or come from PV nodes are the most expensive to recompute
+inline bool tte_protected(TTEntry *tte) {
+    return !age_diff(tte) && (tte_pv(tte) || tte_flag(tte) == FLAG_EXACT);
+}
+
+void storeEntry(TTEntry *entry, U64 key, Move m, int depth, int score, int staticEval, uint8_t flag, bool pv)
 {
     #ifndef __TUNE__
     uint16_t upper = (uint16_t)(key >> 48);
-    if (m || upper != entry->hashupper)
-        entry->movecode = m;
-    if (upper != entry->hashupper || depth > entry->depth - 4)
+    U64 data = tte_data(entry);
+    bool sameKey = (uint16_t)(entry->hashupper ^ tte_fold(data)) == upper;
+    TTEntry e;
+    memcpy(&e.movecode, &data, sizeof(U64));
+
+    ///a depth-preferred entry from this search that is deeper than us, or protected and at least as deep, stays put
+    ///and we go to the bucket's always-replace slot instead. Buckets are aligned to their size, so the bucket
+    ///can be recovered from the entry pointer.
+    TTBucket *bucket = (TTBucket *)(uintptr_t(entry) & ~uintptr_t(sizeof(TTBucket) - 1));
+    if (!sameKey && data && entry != &bucket->entries[TT_ALWAYS_SLOT]
+        && !age_diff(&e) && e.depth + (tte_protected(&e) ? 1 : -2) > depth)
     {
-        entry->hashupper = upper;
-        entry->depth = (int8_t)depth;
-        entry->flags = (TT.generation << 2) | flag;
-        entry->static_eval = (int16_t)staticEval;
-        entry->value = (int16_t)score;
+        entry = &bucket->entries[TT_ALWAYS_SLOT];
+        data = tte_data(entry);
+        sameKey = (uint16_t)(entry->hashupper ^ tte_fold(data)) == upper;
+        memcpy(&e.movecode, &data, sizeof(U64));
+        TTSTAT(redirects);
     }
-    #endif
-}
 
-int age_diff(TTEntry *tte) {
-    return (TT.generation - tte_age(tte)) & 0x3F;
+    if (m || !sameKey)
+        e.movecode = m;
+    if (!sameKey || flag == FLAG_EXACT || depth + 2 * pv > e.depth - 4)
+    {
+        e.depth = (int8_t)depth;
+        e.flags = (TT.generation << 3) | (pv << 2) | flag;
+        e.static_eval = (int16_t)staticEval;
+        e.value = (int16_t)score;
+    }
+
+    U64 newData = tte_data(&e);
+    TTSTAT(stores);
+    if (newData == data && sameKey)
+    {
+        TTSTAT(storeSkips);
+        return;
+    }
+    #ifdef TTSTATS
+    if (!sameKey && data)
+        ttstats.replacements++;
+    else if (sameKey)
+        ttstats.sameKeyStores++;
+    ttstats.storeDepths[std::min(std::max(depth, 0), TTSTATS_DEPTHS - 1)]++;
+    #endif // TTSTATS
+    memcpy(&entry->movecode, &newData, sizeof(U64));
+    entry->hashupper = upper ^ tte_fold(newData);
+    #endif
 }
 
-TTEntry *probeTT(U64 key, bool &ttHit)
+TTEntry *probeTT(U64 key, bool &ttHit, TTEntry &ttData)
 {
     #ifndef __TUNE__
     U64 index = key & TT.size_mask;
     TTBucket *bucket = &TT.table[index];
     uint16_t upper = (uint16_t)(key >> 48);
+    TTSTAT(probes);
     for (int i = 0; i < 3; i++)
     {
-        ///entry found
-        if (bucket->entries[i].hashupper == upper)
+        U64 data = tte_data(&bucket->entries[i]);
+        uint16_t check = bucket->entries[i].hashupper ^ tte_fold(data);
+
+        ///entry found, copy it out so that later reads can't see another thread's write
+        if (check == upper && data)
         {
+            TTSTAT(hits);
             ttHit = true;
+            ttData.hashupper = upper;
+            memcpy(&ttData.movecode, &data, sizeof(U64));
             return &bucket->entries[i];
         }
 
         ///blank entry found, this key has never been used
-        if (!bucket->entries[i].hashupper)
+        if (!data)
         {
+            TTSTAT(blankMisses);
             ttHit = false;
+            memset(&ttData, 0, sizeof(TTEntry));
             return &bucket->entries[i];
         }
     }
 
-    ///no matching entry found + no empty entries found, return the least valuable entry
+    ///no matching entry found + no empty entries found, return the least valuable depth-preferred entry
     TTEntry *cheapest = &bucket->entries[0];
-    for (int i = 1; i< 3; i++)
+    for (int i = 1; i < TT_ALWAYS_SLOT; i++)
     {
         if ((bucket->entries[i].depth - age_diff(&bucket->entries[i]) * 16) < (cheapest->depth - age_diff(cheapest) * 16))
             cheapest = &bucket->entries[i];
     }
+    TTSTAT(victimMisses);
     ttHit = false;
+    memset(&ttData, 0, sizeof(TTEntry));
     return cheapest;
     #else
     TTBucket *bucket = &TT.table[0];
     ttHit = false;
+    memset(&ttData, 0, sizeof(TTEntry));
     return &bucket->entries[0];
     #endif
 }
 
+void print_ttstats()
+{
+    ///scan the whole table rather than the sample used by hashfull
+    const int AGES = 8;
+    const int DEPTHS = 8;
+    U64 buckets = TT.size_mask + 1;
+    U64 used = 0;
+    U64 ages[AGES] = {};
+    U64 depths[DEPTHS] = {};
+    U64 fullBuckets = 0;
+    for (U64 i = 0; i < buckets; i++)
+    {
+        int inBucket = 0;
+        for (int j = 0; j < 3; j++)
+        {
+            TTEntry *tte = &TT.table[i].entries[j];
+            if (!tte_data(tte))
+                continue;
+            used++;
+            inBucket++;
+            ages[std::min(age_diff(tte), AGES - 1)]++;
+            depths[std::min(tte->depth / 4, DEPTHS - 1)]++;
+        }
+        fullBuckets += (inBucket == 3);
+    }
+
+    U64 entries = buckets * 3;
+    std::streamsize precision = cout.precision();
+    cout << "Table     : " << TT.table_size / (1024 * 1024) << " MB, " << buckets << " buckets, " << entries << " entries" << endl;
+    cout << "Occupied  : " << used << " (" << std::fixed << std::setprecision(1) << 100.0 * used / entries << "%), full buckets "
+         << 100.0 * fullBuckets / buckets << "%" << endl;
+    cout << "Age       :";
+    for (int i = 0; i < AGES; i++)
+        cout << " " << i << (i == AGES - 1 ? "+" : "") << "=" << ages[i];
+    cout << endl << "Depth     :";
+    for (int i = 0; i < DEPTHS; i++)
+        cout << " " << i * 4 << (i == DEPTHS - 1 ? "+" : "-" + std::to_string(i * 4 + 3)) << "=" << depths[i];
+    cout << endl;
+
+    #ifdef TTSTATS
+    U64 probes = std::max(ttstats.probes, U64(1));
+    U64 stores = std::max(ttstats.stores, U64(1));
+    cout << "Probes    : " << ttstats.probes << ", hits " << 100.0 * ttstats.hits / probes << "%, blank misses "
+         << 100.0 * ttstats.blankMisses / probes << "%, victim misses " << 100.0 * ttstats.victimMisses / probes << "%" << endl;
+    cout << "Stores    : " << ttstats.stores << ", skipped " << 100.0 * ttstats.storeSkips / stores << "%, same key "
+         << 100.0 * ttstats.sameKeyStores / stores << "%, replaced other key " << 100.0 * ttstats.replacements / stores
+         << "%, sent to always-replace slot " << 100.0 * ttstats.redirects / stores << "%" << endl;
+    cout << "Collisions: " << ttstats.badHashMoves << " hash moves rejected as illegal" << endl;
+    cout << "Store depth:";
+    for (int i = 0; i < TTSTATS_DEPTHS; i++)
+        if (ttstats.storeDepths[i])
+            cout << " " << i << (i == TTSTATS_DEPTHS - 1 ? "+" : "") << "=" << ttstats.storeDepths[i];
+    cout << endl;
+    #else
+    cout << "Probe/store counters not compiled in, build with make ttstats" << endl;
+    #endif // TTSTATS
+    cout << std::defaultfloat << std::setprecision(precision);
+}
+
 void start_search() {
-    TT.generation = (TT.generation + 1) % 64;
+    ///processes sharing a table advance one common generation
+    if (TT.shared)
+        TT.generation = TT.shared->generation;
+    TT.generation = (TT.generation + 1) % 32;
+    if (TT.shared)
+        TT.shared->generation = TT.generation;
 }
 
 zobrist::zobrist()
@@ -132,44 +132,115 @@ void prepareThreads()
 {
     memcpy(&main_thread.position, &globalPosition, sizeof(Position));
     main_thread.position.my_thread = &main_thread;
+    init_search_tables();
     get_ready();
 }
 
 void ucinewgame()
 {
     clear_threads();
-    clear_tt();
+    ///a shared table holds other processes' work, only ClearHash wipes it
+    if (!TT.shared)
+        clear_tt();
 }
 
-template<bool Root>
+/// Perft hash shared by the perft threads. Lockless: check holds key ^ data, so an entry
+/// torn by two threads writing at once fails the test and is just a miss.
+struct PerftEntry
+{
+    U64 check;
+    U64 data; // node count << 8 | depth
+};
+
+const int PERFT_HASH_MB = 64;
+PerftEntry* perftTable;
+U64 perftMask;
+
 U64 Perft(Position& pos, int depth) {
-    U64 cnt, nodes = 0;
-    const bool leaf = (depth == 2);
+    if (depth == 1)
+        return MoveList<ALL>(pos).size();
+
+    PerftEntry* entry = &perftTable[pos.key & perftMask];
+    U64 data = entry->data;
+    if ((entry->check ^ data) == pos.key && (data & 0xFF) == U64(depth))
+        return data >> 8;
 
+    U64 nodes = 0;
     for (const auto& m : MoveList<ALL>(pos))
     {
-        if (Root && depth <= 1)
-            cnt = 1, nodes++;
+        pos.do_move(m);
+        nodes += Perft(pos, depth - 1);
+        pos.undo_move(m);
+    }
+
+    data = (nodes << 8) | depth;
+    entry->data = data;
+    entry->check = pos.key ^ data;
+    return nodes;
+}
+
+/// Root moves are handed out one at a time, so a thread that drew a small subtree takes the next one
+void perft_worker(SearchThread* thread, const MoveList<ALL>* rootMoves, U64* counts, std::atomic<int>* next, int depth)
+{
+    Position& pos = thread->position;
+    int i;
+    while ((i = (*next)++) < int(rootMoves->size()))
+    {
+        Move m = rootMoves->begin()[i];
+        if (depth <= 1)
+            counts[i] = 1;
         else
         {
             pos.do_move(m);
-            cnt = leaf ? MoveList<ALL>(pos).size() : Perft<false>(pos, depth - 1);
-            nodes += cnt;
+            counts[i] = Perft(pos, depth - 1);
             pos.undo_move(m);
         }
-        if (Root)
-            cout << m.toString()<<": "<< m.code<<" : "<<cnt <<endl;
     }
-    return nodes;
 }
 
 void perft()
 {
     prepareThreads();
-    U64 nodes = Perft <true> (*root_position, stoi(args[1]));
+    int depth = stoi(args[1]);
+    MoveList<ALL> rootMoves(*root_position);
+    vector<U64> counts(rootMoves.size());
+    std::atomic<int> next(0);
+
+    ///sized like the transposition table up to PERFT_HASH_MB, and only for the length of the command
+    U64 entries = min(TT.table_size, (U64)PERFT_HASH_MB * 1024 * 1024) / sizeof(PerftEntry);
+    perftTable = new PerftEntry[entries]();
+    perftMask = entries - 1;
+
+    int start = getRealTime();
+    vector<thread> threads;
+    for (int i = 0; i < num_threads; i++)
+        threads.emplace_back(perft_worker, (SearchThread*)get_thread(i), &rootMoves, counts.data(), &next, depth);
+    for (thread& t : threads)
+        t.join();
+    int elapsed = getRealTime() - start;
+
+    delete[] perftTable;
+    perftTable = nullptr;
+
+    U64 nodes = 0;
+    for (size_t i = 0; i < rootMoves.size(); i++)
+    {
+        const SMove& m = rootMoves.begin()[i];
+        cout << m.toString()<<": "<< m.code<<" : "<<counts[i] <<endl;
+        nodes += counts[i];
+    }
     cout << "Nodes searched: "<<nodes<<endl;
+    cout << "Time: " << elapsed << " ms, NPS: " << nodes * 1000 / (elapsed + 1) << endl;
 }
 
+#ifdef COPYMAKE
+void copyperft()
+{
+    prepareThreads();
+    copymake_perft(*root_position, stoi(args[1]));
+}
+#endif // COPYMAKE
+
 void cmd_position() {
     if (args[1] == "fen")
         cmd_fen();
@@ -210,6 +281,31 @@ void option(string name, string value) {
     {
         book.set_max_depth(stoi(value));
     }
+    else if (name == "SharedHash")
+    {
+        if (value == "<empty>" || value.empty())
+        {
+            if (TT.shared)
+            {
+                int mb = int(TT.table_size / (1024 * 1024));
+                detach_shared_tt();
+                sharedHashName.clear();
+                reset_tt(mb);
+            }
+        }
+        else
+        {
+            int mb = int(TT.table_size / (1024 * 1024));
+            bool wasShared = TT.shared;
+            if (wasShared)
+                detach_shared_tt();
+            if (!attach_shared_tt(value, mb) && wasShared)
+            {
+                sharedHashName.clear();
+                reset_tt(mb);
+            }
+        }
+    }
     else if (name == "ClearHash")
     {
         clear_tt();
@@ -222,6 +318,22 @@ void option(string name, string value) {
     {
         tb_init(value.c_str());
     }
+    else if (name == "EvalFile")
+    {
+        if (value == "<empty>" || value.empty())
+            nnue_unload();
+        else
+            nnue_load(value);
+        clear_eval_caches();
+    }
+    else if (name == "EvalCache")
+    {
+        resize_eval_caches(std::max(1, stoi(value)));
+    }
+    else if (name == "PawnHash")
+    {
+        resize_pawn_tables(std::max(1, stoi(value)));
+    }
     else if (name == "AnalysisMode")
     {
         if (value == "true")
@@ -253,7 +365,7 @@ void debug()
     prepareThreads();
     cout << *root_position << endl;
     searchInfo *info = &main_thread.ss[2];
-    MoveGen movegen = MoveGen(root_position, NORMAL_SEARCH, MOVE_NONE, 0, 0);
+    MoveGen movegen(root_position, NORMAL_SEARCH, MOVE_NONE, 0, 0);
     Move m;
     cout << "Move ordering: " << endl;
     while ((m = movegen.next_move(info, 0)) != MOVE_NONE)
@@ -261,12 +373,14 @@ void debug()
         cout << move_to_str(m) << " ";
     }
     cout << endl;
+    main_thread.moveTop = movegen.moveList;
 }
 
 void uci() {
     cout << "id name "<< NAME << " " << VERSION << endl << "id author " << AUTHOR << endl;
     cout << "option name Hash type spin default "<< TRANSPOSITION_MB <<" min 1 max 65536" << endl;
     cout << "option name ClearHash type button" << endl;
+    cout << "option name SharedHash type string default <empty>" << endl;
     cout << "option name Threads type spin default 1 min 1 max " << MAX_THREADS << endl;
     cout << "option name MoveOverhead type spin default 100 min 0 max 5000" << endl;
     cout << "option name Ponder type check default false" << endl;
@@ -276,6 +390,9 @@ void uci() {
     cout << "option name SyzygyPath type string default <empty>" << endl;
     cout << "option name SyzygyProbeDepth type spin default 0 min 0 max 127" << endl;
     cout << "option name AnalysisMode type check default false" << endl;
+    cout << "option name EvalFile type string default <empty>" << endl;
+    cout << "option name EvalCache type spin default " << EVALCACHE_MB << " min 1 max 1024" << endl;
+    cout << "option name PawnHash type spin default " << PAWNHASH_MB << " min 1 max 256" << endl;
     cout << "uciok" << endl;
 }
 
@@ -285,6 +402,7 @@ void stop() {
 }
 
 void isready() {
+    init_search_tables();
     cout << "readyok" << endl;
 }
 
@@ -385,6 +503,19 @@ void see() {
     cout << root_position->see(m, 0) << endl;
 }
 
+void tt_stats()
+{
+    #ifdef TTSTATS
+    if (args.size() > 1 && args[1] == "reset")
+    {
+        memset(&ttstats, 0, sizeof(ttstats));
+        return;
+    }
+    #endif // TTSTATS
+    init_search_tables();
+    print_ttstats();
+}
+
 void run(string s)
 {
     if (s == "ucinewgame")
@@ -403,6 +534,10 @@ void run(string s)
         uci();
     if (s == "perft")
         perft();
+    #ifdef COPYMAKE
+    if (s == "copyperft")
+        copyperft();
+    #endif // COPYMAKE
     if (s == "debug")
         debug();
     if (s == "quit")
@@ -417,18 +552,20 @@ void run(string s)
         eval();
     if (s == "ponderhit")
         ponderhit();
+    if (s == "ttstats")
+        tt_stats();
 }
 
 void loop()
 {
     cout << NAME << " "<< VERSION <<" by "<< AUTHOR <<endl;
-#ifdef USE_POPCNT
-    cout << "Using POPCOUNT" << endl;
-#endif
+    if (use_popcnt)
+        cout << "Using POPCOUNT" << endl;
+    if (use_pext)
+        cout << "Using PEXT" << endl;
     string input;
 
     globalPosition.readFEN(STARTFEN);
-    prepareThreads();
 
     while (true)
     {
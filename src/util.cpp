@@ -159,6 +159,11 @@ const string move_to_str(Move code)
 void bench()
 {
     uint64_t nodes = 0;
+    uint64_t evalProbes = 0, evalHits = 0;
+    int tablesStart = getRealTime();
+    init_search_tables();
+    int tablesTime = getRealTime() - tablesStart;
+
     int benchStart = getRealTime();
     is_timeout = false;
     globalLimits.movesToGo = 0;
@@ -170,20 +175,26 @@ void bench()
     globalLimits.depthlimited = true;
     globalLimits.infinite = false;
 
+    clear_eval_caches();
     for (int i = 0; i < 36; i++){
         cout << "\nPosition [" << (i + 1) << "|36]\n" << endl;
         clear_threads();
         clear_tt();
         Position *p = import_fen(benchmarks[i].c_str(), 0);
         get_ready();
+        main_thread.evalCacheProbes = main_thread.evalCacheHits = 0;
         think(p);
         nodes += main_thread.nodes;
+        evalProbes += main_thread.evalCacheProbes;
+        evalHits += main_thread.evalCacheHits;
     }
 
     int time_taken = getRealTime() - benchStart;
 
     cout << "\n------------------------\n";
+    cout << "Startup : " << startupTime << " ms (+" << tablesTime << " ms on first search)" << endl;
     cout << "Time  : " << time_taken << endl;
     cout << "Nodes : " << nodes << endl;
     cout << "NPS   : " << nodes * 1000 / (time_taken + 1) << endl;
+    cout << "Eval cache hits : " << evalHits * 100 / (evalProbes + 1) << "% of " << evalProbes << " probes" << endl;
 }